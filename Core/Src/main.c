@@ -19,12 +19,14 @@
 /* USER CODE END Header */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "dma.h"
 #include "quadspi.h"
 #include "gpio.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "W25q256.h"
+#include "W25q256_bench.h"
 #include <string.h>
 #include <stdlib.h>
 /* USER CODE END Includes */
@@ -46,12 +48,38 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-
+#ifdef QSPI_BENCHMARK
+static uint8_t BenchBuffer[0x10000];
+QSPI_BenchResult BenchReadPolled, BenchReadDma;
+QSPI_BenchResult BenchLineLinear, BenchLineWrap, BenchLineMapped;
+QSPI_BenchResult BenchMapSeq[2], BenchMapRandom[2], BenchMapExit[2];
+QSPI_BenchResult BenchProgConfirmed, BenchProgLean;
+#endif
+#ifdef QSPI_MANIFEST
+/* CRC32 of each sector, dumped with the debugger for Tools/qspi_manifest.py */
+uint32_t QspiManifest[MEMORY_FLASH_SIZE / MEMORY_SECTOR_SIZE];
+QSPI_BenchResult QspiManifestTime;
+#endif
+
+#ifdef LOADER_SEQUENCE_CHECK
+/* Loader entry points, as called by the programmer */
+extern int Init(void);
+extern int Write(uint32_t Address, uint32_t Size, uint8_t *buffer);
+extern int SectorErase(uint32_t EraseStartAddress, uint32_t EraseEndAddress);
+extern uint64_t Verify(uint32_t MemoryAddr, uint32_t RAMBufferAddr, uint32_t Size, uint32_t missalignement);
+
+static uint8_t LoaderCheckBuffer[W25Q256JW_SUBSECTOR_SIZE];
+/* 1 once the sequence passed, 0 if it failed */
+uint8_t LoaderSequenceResult;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
+#ifdef LOADER_SEQUENCE_CHECK
+static uint8_t Loader_SequenceCheck(uint32_t Address);
+#endif
 
 /* USER CODE END PFP */
 
@@ -88,9 +116,30 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_QUADSPI_Init();
   /* USER CODE BEGIN 2 */
   BSP_QSPI_Init();
+#ifdef QSPI_BENCHMARK
+  BSP_QSPI_Bench_Read(&BenchReadPolled, &BenchReadDma, BenchBuffer, 0, sizeof(BenchBuffer));
+  BSP_QSPI_Bench_CacheLine(&BenchLineLinear, &BenchLineWrap, &BenchLineMapped, 1024);
+  BSP_QSPI_Bench_MemoryMapped(&BenchMapSeq[0], &BenchMapRandom[0], &BenchMapExit[0],
+                              QSPI_MMAP_TIMEOUT_DISABLED, 0x4000);
+  BSP_QSPI_Bench_MemoryMapped(&BenchMapSeq[1], &BenchMapRandom[1], &BenchMapExit[1],
+                              QSPI_MMAP_TIMEOUT_XIP, 0x4000);
+  /* Top of the chip */
+  BSP_QSPI_Bench_PageProgram(&BenchProgConfirmed, &BenchProgLean, BenchBuffer,
+                             MEMORY_FLASH_SIZE - (2 * MEMORY_SECTOR_SIZE), sizeof(BenchBuffer));
+#endif
+#ifdef QSPI_MANIFEST
+  BSP_QSPI_Bench_Start();
+  BSP_QSPI_Manifest(QspiManifest, MEMORY_SECTOR_SIZE, MEMORY_FLASH_SIZE / MEMORY_SECTOR_SIZE);
+  BSP_QSPI_Bench_Result(&QspiManifestTime, MEMORY_FLASH_SIZE, BSP_QSPI_Bench_Cycles());
+#endif
+#ifdef LOADER_SEQUENCE_CHECK
+  /* Top of the chip */
+  LoaderSequenceResult = Loader_SequenceCheck(0x90000000 + MEMORY_FLASH_SIZE - W25Q256JW_SUBSECTOR_SIZE);
+#endif
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -156,6 +205,51 @@ void SystemClock_Config(void)
 }
 
 /* USER CODE BEGIN 4 */
+#ifdef LOADER_SEQUENCE_CHECK
+/**
+  * @brief  Replays the calls of the programmer on one 4K sector, with an
+  *         Init() before each operation: Init, SectorErase, Init, Write,
+  *         Init, Verify, three times. The second image sets bits the first
+  *         one cleared, so it only reads back if the erase requested before
+  *         the Init() calls has been done. The third one is blank: with
+  *         LOADER_ERASE_LAZY, Write() leaves the sector marked and only
+  *         the sweep of Verify() erases it.
+  * @param  Address: sector address in the memory-mapped window
+  * @retval 1 if the data read back, 0 otherwise
+  */
+static uint8_t Loader_SequenceCheck(uint32_t Address)
+{
+  static const uint8_t fill[3] = {0x5A, 0xA5, 0xFF};
+  uint64_t result;
+  uint32_t i;
+
+  for (i = 0; i < sizeof(fill); i++)
+  {
+    memset(LoaderCheckBuffer, fill[i], sizeof(LoaderCheckBuffer));
+
+    if ((Init() != 1) || (SectorErase(Address, Address + sizeof(LoaderCheckBuffer) - 1) != 1))
+    {
+      return 0;
+    }
+    if ((Init() != 1) || (Write(Address, sizeof(LoaderCheckBuffer), LoaderCheckBuffer) != 1))
+    {
+      return 0;
+    }
+    if (Init() != 1)
+    {
+      return 0;
+    }
+    /* Checksum in the upper word, failing address in the lower one */
+    result = Verify(Address, (uint32_t) LoaderCheckBuffer, sizeof(LoaderCheckBuffer) / 4, 0);
+    if ((result == 0) || ((uint32_t) result != 0))
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+#endif
 
 /* USER CODE END 4 */
 
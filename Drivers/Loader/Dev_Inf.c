@@ -5,6 +5,7 @@
 #include "../Loader/Dev_Inf.h"
 
 #include "w25q256.h"
+#include "Loader_Packed.h"
 
 /* This structure contains information used by ST-LINK Utility to program and erase the device */
 #if defined (__ICCARM__)
@@ -15,12 +16,12 @@ struct StorageInfo const StorageInfo = {
 		"256QSPI_flashloader_CSP" ,// Device Name + version number
 		NOR_FLASH ,// Device Type
 		0x90000000 ,// Device Start Address
-		MEMORY_FLASH_SIZE ,// Device Size in Bytes
+		LOADER_DEVICE_SIZE ,// Device Size in Bytes, packed window included
 		MEMORY_PAGE_SIZE ,// Programming Page Size
 		0xFF ,// Initial Content of Erased Memory
 
 // Specify Size and Address of Sectors (view example below)
-		{ { (MEMORY_FLASH_SIZE / MEMORY_SECTOR_SIZE) ,// Sector Numbers,
-			(uint32_t) MEMORY_SECTOR_SIZE } ,//Sector Size
+		{ { (LOADER_DEVICE_SIZE / W25Q256JW_SUBSECTOR_SIZE) ,// Sector Numbers,
+			(uint32_t) W25Q256JW_SUBSECTOR_SIZE } ,//Sector Size, SectorErase() merges them in 32K/64K erases
 
 			{ 0x00000000 , 0x00000000 } } };
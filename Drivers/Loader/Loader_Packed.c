@@ -0,0 +1,314 @@
+/*
+ * Loader_Packed.c
+ *
+ * Unpacks the LZ4 streams described in Loader_Packed.h. The stream comes in
+ * Write() chunks of any size: the frames are gathered in RAM, decoded and
+ * written with BSP_QSPI_Update(), which only erases the blocks the data
+ * needs, since the programmer erases the window instead of the memory.
+ * Verify() feeds the stream the same way and compares the decoded frames
+ * with the memory, through the memory-mapped window.
+ */
+#include "Loader_Packed.h"
+#include <string.h>
+
+#if LOADER_PACKED_WRITE
+static Loader_PackedHeader Loader_PackedFrame;
+static uint8_t Loader_PackedInput[LOADER_PACKED_INPUT_SIZE];
+static uint8_t Loader_PackedOutput[LOADER_PACKED_FRAME_SIZE] __attribute__((aligned(32)));
+
+/* Next stream offset expected */
+static uint32_t Loader_PackedNext;
+
+/* Bytes of the current frame received, header included */
+static uint32_t Loader_PackedFill;
+
+/* Set once the end of the stream is reached */
+static uint8_t Loader_PackedDone;
+
+/* Set while the stream is verified rather than written */
+static uint8_t Loader_PackedVerifying;
+
+static uint8_t Loader_PackedFeed(uint32_t Offset, uint32_t Size, const uint8_t *pData, uint8_t Verifying);
+static uint8_t Loader_PackedCheckHeader(void);
+static uint8_t Loader_PackedFlush(void);
+#endif
+
+/**
+ * @brief   Forgets the stream in progress.
+ * @retval  None
+ */
+void Loader_PackedReset(void)
+{
+#if LOADER_PACKED_WRITE
+	Loader_PackedNext = 0;
+	Loader_PackedFill = 0;
+	Loader_PackedDone = 0;
+#endif
+}
+
+/**
+ * @brief   Takes the next chunk of a packed stream and writes the frames it
+ *          completes. A stream starts at offset 0 and continues without gap.
+ * @param   Offset : chunk offset in the stream
+ * @param   Size   : chunk size
+ * @param   pData  : chunk
+ * @retval  QSPI memory status
+ */
+uint8_t Loader_PackedWrite(uint32_t Offset, uint32_t Size, const uint8_t *pData)
+{
+#if LOADER_PACKED_WRITE
+	return Loader_PackedFeed(Offset, Size, pData, 0);
+#else
+	(void) Offset;
+	(void) Size;
+	(void) pData;
+
+	return QSPI_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief   Takes the next chunk of a packed stream and compares the frames
+ *          it completes with the memory, which must be memory-mapped. A
+ *          stream starts at offset 0 and continues without gap.
+ * @param   Offset : chunk offset in the stream
+ * @param   Size   : chunk size
+ * @param   pData  : chunk
+ * @retval  QSPI memory status, QSPI_VERIFY_FAILED on a difference
+ */
+uint8_t Loader_PackedVerify(uint32_t Offset, uint32_t Size, const uint8_t *pData)
+{
+#if LOADER_PACKED_WRITE
+	return Loader_PackedFeed(Offset, Size, pData, 1);
+#else
+	(void) Offset;
+	(void) Size;
+	(void) pData;
+
+	return QSPI_NOT_SUPPORTED;
+#endif
+}
+
+#if LOADER_PACKED_WRITE
+/**
+ * @brief   Gathers the frames of a stream and flushes each one completed.
+ * @param   Offset    : chunk offset in the stream
+ * @param   Size      : chunk size
+ * @param   pData     : chunk
+ * @param   Verifying : 1 to compare the frames, 0 to write them
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_PackedFeed(uint32_t Offset, uint32_t Size, const uint8_t *pData, uint8_t Verifying)
+{
+	uint32_t count;
+	uint8_t status;
+
+	if(Offset == 0)
+	{
+		Loader_PackedReset();
+		Loader_PackedVerifying = Verifying;
+	}
+	if((Offset != Loader_PackedNext) || (Verifying != Loader_PackedVerifying))
+	{
+		return QSPI_ERROR;
+	}
+	Loader_PackedNext += Size;
+
+	while((Size != 0) && (Loader_PackedDone == 0))
+	{
+		if(Loader_PackedFill < sizeof(Loader_PackedHeader))
+		{
+			count = sizeof(Loader_PackedHeader) - Loader_PackedFill;
+			count = (count > Size) ? Size : count;
+			memcpy((uint8_t*) &Loader_PackedFrame + Loader_PackedFill, pData, count);
+		}
+		else
+		{
+			count = sizeof(Loader_PackedHeader) + Loader_PackedFrame.PackedSize - Loader_PackedFill;
+			count = (count > Size) ? Size : count;
+			memcpy(&Loader_PackedInput[Loader_PackedFill - sizeof(Loader_PackedHeader)], pData, count);
+		}
+		Loader_PackedFill += count;
+		pData += count;
+		Size -= count;
+
+		if(Loader_PackedFill == sizeof(Loader_PackedHeader))
+		{
+			if(Loader_PackedCheckHeader() != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		if((Loader_PackedDone == 0) && (Loader_PackedFill >= sizeof(Loader_PackedHeader))
+				&& (Loader_PackedFill == (sizeof(Loader_PackedHeader) + Loader_PackedFrame.PackedSize)))
+		{
+			status = Loader_PackedFlush();
+			if(status != QSPI_OK)
+			{
+				return status;
+			}
+			Loader_PackedFill = 0;
+		}
+	}
+
+	return QSPI_OK;
+}
+#endif
+
+/**
+ * @brief   Decodes an LZ4 block. Every length and offset is checked against
+ *          the buffers.
+ * @param   pSrc    : LZ4 block
+ * @param   SrcSize : block size
+ * @param   pDst    : destination
+ * @param   DstSize : destination size
+ * @retval  Decoded size, -1 if the block is malformed or too large
+ */
+int32_t Loader_Lz4Decode(const uint8_t *pSrc, uint32_t SrcSize, uint8_t *pDst, uint32_t DstSize)
+{
+	const uint8_t *src_end = pSrc + SrcSize;
+	uint8_t *dst = pDst;
+	uint8_t *dst_end = pDst + DstSize;
+	const uint8_t *match;
+	uint32_t token, length, offset, byte;
+
+	while(pSrc < src_end)
+	{
+		token = *pSrc++;
+
+		/* Literals */
+		length = token >> 4;
+		if(length == 15)
+		{
+			do
+			{
+				if(pSrc >= src_end)
+				{
+					return -1;
+				}
+				byte = *pSrc++;
+				length += byte;
+			}
+			while(byte == 255);
+		}
+		if((length > (uint32_t) (src_end - pSrc)) || (length > (uint32_t) (dst_end - dst)))
+		{
+			return -1;
+		}
+		memcpy(dst, pSrc, length);
+		dst += length;
+		pSrc += length;
+
+		/* The last sequence has no match */
+		if(pSrc == src_end)
+		{
+			break;
+		}
+
+		/* Match */
+		if((src_end - pSrc) < 2)
+		{
+			return -1;
+		}
+		offset = pSrc[0] | (pSrc[1] << 8);
+		pSrc += 2;
+		if((offset == 0) || (offset > (uint32_t) (dst - pDst)))
+		{
+			return -1;
+		}
+
+		length = token & 15;
+		if(length == 15)
+		{
+			do
+			{
+				if(pSrc >= src_end)
+				{
+					return -1;
+				}
+				byte = *pSrc++;
+				length += byte;
+			}
+			while(byte == 255);
+		}
+		length += 4;
+		if(length > (uint32_t) (dst_end - dst))
+		{
+			return -1;
+		}
+
+		match = dst - offset;
+		if(offset == 1)
+		{
+			/* Run of one byte, as the padding of the images */
+			memset(dst, *match, length);
+			dst += length;
+		}
+		else
+		{
+			while(length-- != 0)
+			{
+				*dst++ = *match++;
+			}
+		}
+	}
+
+	return (int32_t) (dst - pDst);
+}
+
+#if LOADER_PACKED_WRITE
+/**
+ * @brief   Checks the header just received.
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_PackedCheckHeader(void)
+{
+	uint32_t address = Loader_PackedFrame.Address & 0x0fffffff;
+
+	if(Loader_PackedFrame.Magic == LOADER_PACKED_END)
+	{
+		Loader_PackedDone = 1;
+		return QSPI_OK;
+	}
+
+	if((Loader_PackedFrame.Magic != LOADER_PACKED_MAGIC)
+			|| (Loader_PackedFrame.RawSize > LOADER_PACKED_FRAME_SIZE)
+			|| (Loader_PackedFrame.PackedSize > LOADER_PACKED_INPUT_SIZE)
+			|| (address >= MEMORY_FLASH_SIZE)
+			|| (Loader_PackedFrame.RawSize > (MEMORY_FLASH_SIZE - address)))
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Decodes the frame received, then writes it or compares it with
+ *          the memory.
+ * @retval  QSPI memory status, QSPI_VERIFY_FAILED on a difference
+ */
+static uint8_t Loader_PackedFlush(void)
+{
+	uint32_t address = Loader_PackedFrame.Address & 0x0fffffff;
+
+	if(Loader_Lz4Decode(Loader_PackedInput, Loader_PackedFrame.PackedSize, Loader_PackedOutput,
+			Loader_PackedFrame.RawSize) != (int32_t) Loader_PackedFrame.RawSize)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(Loader_PackedVerifying != 0)
+	{
+		if(memcmp((const uint8_t*) (QSPI_MMAP_BASE + address), Loader_PackedOutput,
+				Loader_PackedFrame.RawSize) != 0)
+		{
+			return QSPI_VERIFY_FAILED;
+		}
+		return QSPI_OK;
+	}
+
+	return Loader_UpdateFrame(Loader_PackedOutput, address, Loader_PackedFrame.RawSize);
+}
+#endif
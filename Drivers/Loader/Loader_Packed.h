@@ -0,0 +1,55 @@
+/*
+ * Loader_Packed.h
+ *
+ * LZ4 packed images for the external loader. The host packer
+ * (Tools/qspi_pack.py) cuts the image in frames of at most
+ * LOADER_PACKED_FRAME_SIZE bytes, each one an LZ4 block behind a
+ * Loader_PackedHeader. The stream is programmed at LOADER_PACKED_BASE, a
+ * window declared after the memory, and Write() unpacks it to the
+ * addresses of the frames. Verify() unpacks it again and compares the
+ * frames with the memory. The window is mapped too, so that reads of the
+ * programmer there land on the memory (aliased) instead of faulting.
+ */
+#ifndef LOADER_PACKED_H_
+#define LOADER_PACKED_H_
+
+#include "w25q256.h"
+
+/* Accept packed streams in the window after the memory */
+#ifndef LOADER_PACKED_WRITE
+#define LOADER_PACKED_WRITE        0
+#endif
+
+#define LOADER_PACKED_BASE         (0x90000000 + MEMORY_FLASH_SIZE)
+#define LOADER_PACKED_SIZE         MEMORY_FLASH_SIZE
+
+/* Size declared to the programmer */
+#if LOADER_PACKED_WRITE
+#define LOADER_DEVICE_SIZE         (MEMORY_FLASH_SIZE + LOADER_PACKED_SIZE)
+#else
+#define LOADER_DEVICE_SIZE         MEMORY_FLASH_SIZE
+#endif
+
+#define LOADER_PACKED_MAGIC        0x5A4C5051 /* "QPLZ" */
+#define LOADER_PACKED_END          0xFFFFFFFF /* end of stream, or padding of the programmer */
+#define LOADER_PACKED_FRAME_SIZE   MEMORY_SECTOR_SIZE /* largest unpacked frame */
+#define LOADER_PACKED_INPUT_SIZE   (LOADER_PACKED_FRAME_SIZE + (LOADER_PACKED_FRAME_SIZE / 255) + 16) /* LZ4 worst case */
+
+typedef struct
+{
+	uint32_t Magic; /*!< LOADER_PACKED_MAGIC, LOADER_PACKED_END after the last frame */
+	uint32_t Address; /*!< Memory address of the unpacked data */
+	uint32_t RawSize; /*!< Unpacked size */
+	uint32_t PackedSize; /*!< Size of the LZ4 block following the header */
+} Loader_PackedHeader;
+
+void Loader_PackedReset(void);
+uint8_t Loader_PackedWrite(uint32_t Offset, uint32_t Size, const uint8_t *pData);
+uint8_t Loader_PackedVerify(uint32_t Offset, uint32_t Size, const uint8_t *pData);
+int32_t Loader_Lz4Decode(const uint8_t *pSrc, uint32_t SrcSize, uint8_t *pDst, uint32_t DstSize);
+
+/* Provided by Loader_Src.c: writes a frame once the erases pending in its
+ * units are done */
+uint8_t Loader_UpdateFrame(uint8_t *pData, uint32_t Address, uint32_t Size);
+
+#endif /* LOADER_PACKED_H_ */
@@ -1,12 +1,99 @@
 #include "quadspi.h"
 #include "main.h"
 #include "gpio.h"
+#include "dma.h"
 #include "w25q256.h"
+#include "Loader_Packed.h"
+#include <string.h>
 
 #define LOADER_OK   0x1
 #define LOADER_FAIL 0x0
 extern void SystemClock_Config(void);
 
+/* Erase policy of SectorErase() and MassErase()
+ * LOADER_ERASE_IMMEDIATE    : erase when asked
+ * LOADER_ERASE_DIFFERENTIAL : only mark the units to erase. Write() compares
+ *                             the data with the memory and erases a unit only
+ *                             if the data sets bits the memory has cleared,
+ *                             data that only clears bits is programmed over
+ *                             the old one. Verify() erases the marked units
+ *                             that were not written and are not blank, so the
+ *                             programmer must run its verify step.
+ * LOADER_ERASE_AHEAD        : mark the units to erase and start erasing the
+ *                             first marked block in the background. Write()
+ *                             erases the marked blocks it targets, then starts
+ *                             the erase of the next one before returning, so
+ *                             it runs while the programmer sends the next
+ *                             data. Verify() erases the marked units left.
+ * LOADER_ERASE_LAZY         : only mark the units to erase. Write() erases a
+ *                             marked block on the first data that is not
+ *                             blank, without comparing with the memory; blank
+ *                             data leaves it marked. Verify() erases the
+ *                             marked units that are not blank. */
+#define LOADER_ERASE_IMMEDIATE     0
+#define LOADER_ERASE_DIFFERENTIAL  1
+#define LOADER_ERASE_AHEAD         2
+#define LOADER_ERASE_LAZY          3
+
+#ifndef LOADER_ERASE_POLICY
+#define LOADER_ERASE_POLICY        LOADER_ERASE_IMMEDIATE
+#endif
+
+/* Write() stages each page while the previous one programs and returns
+ * while the last page programs, the next call waits for it.
+ * Only the immediate policy writes behind */
+#ifndef LOADER_WRITE_BEHIND
+#define LOADER_WRITE_BEHIND        0
+#endif
+
+/* Write() reads each page back once programmed and fails on the first
+ * mismatch, so the programmer's verify pass can be left out (except with
+ * LOADER_ERASE_DIFFERENTIAL, LOADER_ERASE_AHEAD and LOADER_ERASE_LAZY, which
+ * need Verify()) */
+#ifndef LOADER_WRITE_VERIFY
+#define LOADER_WRITE_VERIFY        0
+#endif
+
+#define LOADER_FLASH_BASE          0x90000000
+#define LOADER_UNIT_SIZE           W25Q256JW_SUBSECTOR_SIZE
+#define LOADER_UNITS               (MEMORY_FLASH_SIZE / LOADER_UNIT_SIZE)
+#define LOADER_NO_UNIT             0xFFFFFFFF
+
+#define LOADER_STATE_LOADED        0x4C4F4144 /* "LOAD", erase state not set up yet */
+#define LOADER_STATE_VALID         0x56414C44 /* "VALD" */
+
+/* In .data, so it is reset each time the programmer loads the loader but
+ * kept across the Init() calls the programmer makes between operations */
+static uint32_t Loader_State = LOADER_STATE_LOADED;
+
+/* Units whose erase was requested and not done yet, one bit per unit */
+static uint32_t Loader_ErasePending[LOADER_UNITS / 32];
+
+/* Pending unit being written, and its bytes already found in the memory */
+static uint32_t Loader_OpenUnit;
+static uint32_t Loader_OpenStart;
+static uint32_t Loader_OpenEnd;
+
+/* Copy of the unit bytes to keep across its erase */
+static uint8_t Loader_UnitBuffer[LOADER_UNIT_SIZE] __attribute__((aligned(32)));
+
+static uint8_t Loader_MemoryMapped(void);
+static uint8_t Loader_Indirect(void);
+static void Loader_SetPending(uint32_t StartAddress, uint32_t EndAddress);
+static uint8_t Loader_IsPending(uint32_t Unit);
+static void Loader_ClearPending(uint32_t Unit);
+static uint8_t Loader_IsBlank(uint32_t Address, uint32_t Size);
+static uint8_t Loader_DataIsBlank(const volatile uint8_t *pData, uint32_t Size);
+static uint8_t Loader_EraseUnit(uint32_t Unit);
+static uint8_t Loader_CloseUnit(void);
+static uint8_t Loader_WriteDifferential(uint32_t Address, uint32_t Size, uint8_t *pData);
+static uint8_t Loader_Sweep(void);
+static uint32_t Loader_PendingBlock(uint32_t Unit, uint32_t *pAddress);
+static uint8_t Loader_ErasePendingBlock(uint32_t Unit, uint8_t Background, uint8_t *pStarted);
+static uint8_t Loader_EraseAhead(void);
+static uint8_t Loader_WriteAhead(uint32_t Address, uint32_t Size, uint8_t *pData);
+static uint8_t Loader_WriteLazy(uint32_t Address, uint32_t Size, uint8_t *pData);
+
 /**
  * @brief  System initialization.
  * @param  None
@@ -40,6 +127,17 @@ int Init(void)
 
 	MX_GPIO_Init();
 
+	MX_DMA_Init();
+
+	/* The erase or the page left running by the previous operation ends
+	 * before the peripheral is reset (the driver state is only valid once
+	 * set up by a first Init()) */
+	if((Loader_State == LOADER_STATE_VALID) && (BSP_QSPI_Flush() != QSPI_OK))
+	{
+		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
+		return LOADER_FAIL;
+	}
+
 	__HAL_RCC_QSPI_FORCE_RESET();//completely reset peripheral
 	__HAL_RCC_QSPI_RELEASE_RESET();
 
@@ -49,15 +147,37 @@ int Init(void)
 		return LOADER_FAIL;
 	}
 
+	/* The loader image carries no cleared .bss: the erase state is set up at
+	 * the first Init() after a load, the next ones keep what the previous
+	 * operations left pending */
+	if(Loader_State != LOADER_STATE_VALID)
+	{
+		memset(Loader_ErasePending, 0, sizeof(Loader_ErasePending));
+		Loader_OpenUnit = LOADER_NO_UNIT;
+		Loader_PackedReset();
+		Loader_State = LOADER_STATE_VALID;
+	}
+
+	/* The session may end in memory-mapped mode: no continuous read, so the
+	 * memory still takes commands from firmware unaware of the mode bits */
 	MX_QUADSPI_Init();
-	if(BSP_QSPI_Init() != QSPI_OK)
+	if((BSP_QSPI_Init() != QSPI_OK) || (BSP_QSPI_SetWriteVerify(LOADER_WRITE_VERIFY) != QSPI_OK)
+			|| (BSP_QSPI_SetMemoryMappedProfile(QSPI_MMAP_PROFILE_QUAD_OUT) != QSPI_OK))
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
 		return LOADER_FAIL;
 	}
 
-	if(HAL_QSPI_Abort(&hqspi) != HAL_OK)
+	/* The packed window, as large as the memory, is mapped after it: the
+	 * reads of the programmer there alias the memory instead of faulting */
+	if(LOADER_PACKED_WRITE != 0)
+	{
+		hqspi.Init.FlashSize++;
+		MODIFY_REG(hqspi.Instance->DCR, QUADSPI_DCR_FSIZE, (hqspi.Init.FlashSize << QUADSPI_DCR_FSIZE_Pos));
+	}
+
+	if(BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK)
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
@@ -86,18 +206,54 @@ int Init(void)
  */
 int Write(uint32_t Address , uint32_t Size , uint8_t *buffer)
 {
+	uint8_t status;
+
 	HAL_GPIO_WritePin(LED_OK_GPIO_Port, LED_OK_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_RESET);
 //	__set_PRIMASK(0);//enable interrupts
 
-	if(HAL_QSPI_Abort(&hqspi) != HAL_OK)
+	if((BSP_QSPI_Flush() != QSPI_OK) || (BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK))
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
 		return LOADER_FAIL;
 	}
 
-	if(BSP_QSPI_Write((uint8_t*) buffer, (Address & (0x0fffffff)), Size) != QSPI_OK)
+	if((LOADER_PACKED_WRITE != 0) && (Address >= LOADER_PACKED_BASE))
+	{
+		/* Packed stream, unpacked to the memory */
+		status = Loader_CloseUnit();
+		if(status == QSPI_OK)
+		{
+			status = Loader_Indirect();
+		}
+		if(status == QSPI_OK)
+		{
+			status = Loader_PackedWrite(Address - LOADER_PACKED_BASE, Size, buffer);
+		}
+	}
+	else if(LOADER_ERASE_POLICY == LOADER_ERASE_DIFFERENTIAL)
+	{
+		status = Loader_WriteDifferential((Address & (0x0fffffff)), Size, buffer);
+	}
+	else if(LOADER_ERASE_POLICY == LOADER_ERASE_AHEAD)
+	{
+		status = Loader_WriteAhead((Address & (0x0fffffff)), Size, buffer);
+	}
+	else if(LOADER_ERASE_POLICY == LOADER_ERASE_LAZY)
+	{
+		status = Loader_WriteLazy((Address & (0x0fffffff)), Size, buffer);
+	}
+	else if(LOADER_WRITE_BEHIND != 0)
+	{
+		status = BSP_QSPI_WriteBehind((uint8_t*) buffer, (Address & (0x0fffffff)), Size);
+	}
+	else
+	{
+		status = BSP_QSPI_Write_DMA((uint8_t*) buffer, (Address & (0x0fffffff)), Size);
+	}
+
+	if(status != QSPI_OK)
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
@@ -118,18 +274,45 @@ int Write(uint32_t Address , uint32_t Size , uint8_t *buffer)
  */
 int SectorErase(uint32_t EraseStartAddress , uint32_t EraseEndAddress)
 {
+	uint8_t status;
+
 	HAL_GPIO_WritePin(LED_OK_GPIO_Port, LED_OK_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_RESET);
 //	__set_PRIMASK(0);//enable interrupts
 
-	if(HAL_QSPI_Abort(&hqspi) != HAL_OK)
+	if((BSP_QSPI_Flush() != QSPI_OK) || (BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK))
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
 		return LOADER_FAIL;
 	}
 
-	if(BSP_QSPI_Erase_Sector(EraseStartAddress, EraseEndAddress) != QSPI_OK)
+	/* The packed window has nothing to erase */
+	if(EraseEndAddress >= LOADER_PACKED_BASE)
+	{
+		EraseEndAddress = LOADER_PACKED_BASE - 1;
+	}
+
+	if(EraseStartAddress >= LOADER_PACKED_BASE)
+	{
+		status = QSPI_OK;
+	}
+	else if((LOADER_ERASE_POLICY == LOADER_ERASE_DIFFERENTIAL) || (LOADER_ERASE_POLICY == LOADER_ERASE_LAZY))
+	{
+		status = Loader_CloseUnit();
+		Loader_SetPending(EraseStartAddress, EraseEndAddress);
+	}
+	else if(LOADER_ERASE_POLICY == LOADER_ERASE_AHEAD)
+	{
+		Loader_SetPending(EraseStartAddress, EraseEndAddress);
+		status = Loader_EraseAhead();
+	}
+	else
+	{
+		status = BSP_QSPI_Erase_Range(EraseStartAddress, EraseEndAddress);
+	}
+
+	if(status != QSPI_OK)
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
@@ -153,18 +336,35 @@ int SectorErase(uint32_t EraseStartAddress , uint32_t EraseEndAddress)
  */
 int MassErase(void)
 {
+	uint8_t status;
+
 	HAL_GPIO_WritePin(LED_OK_GPIO_Port, LED_OK_Pin, GPIO_PIN_RESET);
 	HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_RESET);
 //	__set_PRIMASK(0);//enable interrupts
 
-	if(HAL_QSPI_Abort(&hqspi) != HAL_OK)
+	if((BSP_QSPI_Flush() != QSPI_OK) || (BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK))
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
 		return LOADER_FAIL;
 	}
 
-	if(BSP_QSPI_Erase_Chip() != QSPI_OK)
+	if((LOADER_ERASE_POLICY == LOADER_ERASE_DIFFERENTIAL) || (LOADER_ERASE_POLICY == LOADER_ERASE_LAZY))
+	{
+		status = Loader_CloseUnit();
+		Loader_SetPending(0, MEMORY_FLASH_SIZE - 1);
+	}
+	else if(LOADER_ERASE_POLICY == LOADER_ERASE_AHEAD)
+	{
+		Loader_SetPending(0, MEMORY_FLASH_SIZE - 1);
+		status = Loader_EraseAhead();
+	}
+	else
+	{
+		status = BSP_QSPI_Erase_Chip();
+	}
+
+	if(status != QSPI_OK)
 	{
 		__set_PRIMASK(1);//disable interrupts
 		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
@@ -282,6 +482,22 @@ uint64_t Verify(uint32_t MemoryAddr , uint32_t RAMBufferAddr , uint32_t Size ,
 	uint64_t checksum;
 	Size *= 4;
 
+	/* Erase or page left running by the last call */
+	if(BSP_QSPI_Flush() != QSPI_OK)
+	{
+		__set_PRIMASK(1);//disable interrupts
+		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
+		return LOADER_FAIL;
+	}
+
+	/* Complete the erases left pending */
+	if((LOADER_ERASE_POLICY != LOADER_ERASE_IMMEDIATE) && (Loader_Sweep() != QSPI_OK))
+	{
+		__set_PRIMASK(1);//disable interrupts
+		HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
+		return LOADER_FAIL;
+	}
+
 	if(BSP_QSPI_MemoryMappedMode() != QSPI_OK)
 	{
 		__set_PRIMASK(1);//disable interrupts
@@ -289,6 +505,24 @@ uint64_t Verify(uint32_t MemoryAddr , uint32_t RAMBufferAddr , uint32_t Size ,
 		return LOADER_FAIL;
 	}
 
+	/* A packed stream is not in the memory: the checksum is the one of the
+	 * stream, and its frames are unpacked again and compared with the
+	 * memory */
+	if((LOADER_PACKED_WRITE != 0) && (MemoryAddr >= LOADER_PACKED_BASE))
+	{
+		checksum = CheckSum(RAMBufferAddr + (missalignement & 0xf), Size
+									- ((missalignement >> 16) & 0xF), InitVal);
+		if(Loader_PackedVerify(MemoryAddr - LOADER_PACKED_BASE, Size, (const uint8_t*) RAMBufferAddr) != QSPI_OK)
+		{
+			__set_PRIMASK(1);//disable interrupts
+			HAL_GPIO_WritePin(LED_ERROR_GPIO_Port, LED_ERROR_Pin, GPIO_PIN_SET);
+			return ((checksum << 32) + MemoryAddr);
+		}
+		__set_PRIMASK(1);//disable interrupts
+		HAL_GPIO_WritePin(LED_OK_GPIO_Port, LED_OK_Pin, GPIO_PIN_SET);
+		return (checksum << 32);
+	}
+
 	checksum = CheckSum((uint32_t) MemoryAddr + (missalignement & 0xf), Size
 								- ((missalignement >> 16) & 0xF), InitVal);
 	while(Size > VerifiedData)
@@ -306,3 +540,567 @@ uint64_t Verify(uint32_t MemoryAddr , uint32_t RAMBufferAddr , uint32_t Size ,
 	HAL_GPIO_WritePin(LED_OK_GPIO_Port, LED_OK_Pin, GPIO_PIN_SET);
 	return (checksum << 32);
 }
+
+/**
+ * @brief  Enters the memory-mapped mode unless already in it.
+ * @retval QSPI memory status
+ */
+static uint8_t Loader_MemoryMapped(void)
+{
+	if(HAL_QSPI_GetState(&hqspi) == HAL_QSPI_STATE_BUSY_MEM_MAPPED)
+	{
+		return QSPI_OK;
+	}
+
+	return BSP_QSPI_MemoryMappedMode();
+}
+
+/**
+ * @brief  Leaves the memory-mapped mode if in it.
+ * @retval QSPI memory status
+ */
+static uint8_t Loader_Indirect(void)
+{
+	if(HAL_QSPI_GetState(&hqspi) != HAL_QSPI_STATE_BUSY_MEM_MAPPED)
+	{
+		return QSPI_OK;
+	}
+
+	return BSP_QSPI_ExitMemoryMappedMode();
+}
+
+/**
+ * @brief   Marks for erase the units BSP_QSPI_Erase_Range() would erase.
+ * @param   StartAddress : erase start address
+ * @param   EndAddress   : erase end address
+ * @retval  None
+ */
+static void Loader_SetPending(uint32_t StartAddress, uint32_t EndAddress)
+{
+	uint32_t unit, last;
+
+	StartAddress &= 0x0fffffff;
+	EndAddress &= 0x0fffffff;
+	if(EndAddress >= MEMORY_FLASH_SIZE)
+	{
+		EndAddress = MEMORY_FLASH_SIZE - 1;
+	}
+
+	unit = StartAddress / LOADER_UNIT_SIZE;
+	last = EndAddress / LOADER_UNIT_SIZE;
+	for( ; unit <= last ; unit++)
+	{
+		Loader_ErasePending[unit / 32] |= (1UL << (unit % 32));
+	}
+}
+
+/**
+ * @brief   Tells whether a unit is marked for erase.
+ * @param   Unit : unit index
+ * @retval  1 if marked, 0 otherwise
+ */
+static uint8_t Loader_IsPending(uint32_t Unit)
+{
+	return ((Loader_ErasePending[Unit / 32] & (1UL << (Unit % 32))) != 0);
+}
+
+/**
+ * @brief   Clears the erase mark of a unit.
+ * @param   Unit : unit index
+ * @retval  None
+ */
+static void Loader_ClearPending(uint32_t Unit)
+{
+	Loader_ErasePending[Unit / 32] &= ~(1UL << (Unit % 32));
+}
+
+/**
+ * @brief   Tells whether a memory area is erased, through the memory-mapped
+ *          window.
+ * @param   Address : memory address
+ * @param   Size    : number of bytes
+ * @retval  1 if blank, 0 otherwise
+ */
+static uint8_t Loader_IsBlank(uint32_t Address, uint32_t Size)
+{
+	return Loader_DataIsBlank((const volatile uint8_t*) (LOADER_FLASH_BASE + Address), Size);
+}
+
+/**
+ * @brief   Tells whether data only holds 0xFF bytes.
+ * @param   pData : data, in RAM or in the memory-mapped window
+ * @param   Size  : number of bytes
+ * @retval  1 if blank, 0 otherwise
+ */
+static uint8_t Loader_DataIsBlank(const volatile uint8_t *pData, uint32_t Size)
+{
+	const volatile uint8_t *pmem = pData;
+
+	for( ; (Size != 0) && (((uint32_t) pmem & 3) != 0) ; Size--)
+	{
+		if(*pmem++ != 0xFF)
+		{
+			return 0;
+		}
+	}
+	for( ; Size >= 4 ; Size -= 4, pmem += 4)
+	{
+		if(*(const volatile uint32_t*) pmem != 0xFFFFFFFF)
+		{
+			return 0;
+		}
+	}
+	for( ; Size != 0 ; Size--)
+	{
+		if(*pmem++ != 0xFF)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief   Erases a marked unit. For the open unit, the bytes already found
+ *          in the memory are saved and programmed back.
+ * @param   Unit : unit index
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_EraseUnit(uint32_t Unit)
+{
+	uint32_t address = Unit * LOADER_UNIT_SIZE;
+	uint32_t keep = 0;
+
+	if((Unit == Loader_OpenUnit) && (Loader_OpenEnd > Loader_OpenStart))
+	{
+		if(Loader_MemoryMapped() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		keep = Loader_OpenEnd - Loader_OpenStart;
+		memcpy(&Loader_UnitBuffer[Loader_OpenStart], (const uint8_t*) (LOADER_FLASH_BASE + address + Loader_OpenStart), keep);
+	}
+
+	if(Loader_Indirect() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(BSP_QSPI_Erase_Block(address, LOADER_UNIT_SIZE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if((keep != 0)
+			&& (BSP_QSPI_Write_DMA(&Loader_UnitBuffer[Loader_OpenStart], address + Loader_OpenStart, keep) != QSPI_OK))
+	{
+		return QSPI_ERROR;
+	}
+
+	Loader_ClearPending(Unit);
+	if(Unit == Loader_OpenUnit)
+	{
+		Loader_OpenUnit = LOADER_NO_UNIT;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Completes the open unit: nothing to do if the bytes around the
+ *          ones written are blank, otherwise it is erased.
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_CloseUnit(void)
+{
+	uint32_t address;
+
+	if(Loader_OpenUnit == LOADER_NO_UNIT)
+	{
+		return QSPI_OK;
+	}
+
+	address = Loader_OpenUnit * LOADER_UNIT_SIZE;
+	if(Loader_MemoryMapped() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if((Loader_IsBlank(address, Loader_OpenStart) != 0)
+			&& (Loader_IsBlank(address + Loader_OpenEnd, LOADER_UNIT_SIZE - Loader_OpenEnd) != 0))
+	{
+		Loader_ClearPending(Loader_OpenUnit);
+		Loader_OpenUnit = LOADER_NO_UNIT;
+		return QSPI_OK;
+	}
+
+	return Loader_EraseUnit(Loader_OpenUnit);
+}
+
+/**
+ * @brief   Programs data, skipping what is already in the memory. In the
+ *          units marked for erase, data equal to the memory is not written
+ *          and data that only clears bits is programmed in place, the unit
+ *          stays marked; the first data needing an erase erases the unit.
+ *          The written bytes of a marked unit are tracked while they stay
+ *          contiguous, any other access completes the unit first.
+ * @param   Address : memory address
+ * @param   Size    : size of data
+ * @param   pData   : data
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_WriteDifferential(uint32_t Address, uint32_t Size, uint8_t *pData)
+{
+	uint32_t unit, offset, chunk;
+	uint8_t overwrite;
+
+	while(Size != 0)
+	{
+		unit = Address / LOADER_UNIT_SIZE;
+		offset = Address % LOADER_UNIT_SIZE;
+		chunk = LOADER_UNIT_SIZE - offset;
+		if(chunk > Size)
+		{
+			chunk = Size;
+		}
+
+		if((Loader_OpenUnit != LOADER_NO_UNIT)
+				&& ((unit != Loader_OpenUnit) || (offset != Loader_OpenEnd)))
+		{
+			if(Loader_CloseUnit() != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		if(Loader_IsPending(unit) != 0)
+		{
+			if(Loader_OpenUnit == LOADER_NO_UNIT)
+			{
+				Loader_OpenUnit = unit;
+				Loader_OpenStart = offset;
+				Loader_OpenEnd = offset;
+			}
+
+			if(Loader_MemoryMapped() != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+			overwrite = BSP_QSPI_ClassifyOverwrite((const uint8_t*) (LOADER_FLASH_BASE + Address), pData, chunk);
+			if(overwrite != QSPI_OVERWRITE_ERASE)
+			{
+				/* Already in the memory, or only bits to clear */
+				if(overwrite == QSPI_OVERWRITE_PROGRAM)
+				{
+					if((Loader_Indirect() != QSPI_OK)
+							|| (BSP_QSPI_Write_DMA(pData, Address, chunk) != QSPI_OK))
+					{
+						return QSPI_ERROR;
+					}
+				}
+				Loader_OpenEnd += chunk;
+				Address += chunk;
+				pData += chunk;
+				Size -= chunk;
+				continue;
+			}
+
+			if(Loader_EraseUnit(unit) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		if(Loader_Indirect() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		if(BSP_QSPI_Write_DMA(pData, Address, chunk) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		Address += chunk;
+		pData += chunk;
+		Size -= chunk;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Completes all the erases still pending: the open unit, then the
+ *          runs of marked units, through BSP_QSPI_Erase_Range() which skips
+ *          the blank ones and merges the others in larger erases.
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_Sweep(void)
+{
+	uint32_t unit;
+	uint32_t run = LOADER_NO_UNIT;
+
+	if(Loader_CloseUnit() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(Loader_Indirect() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	for(unit = 0 ; unit <= LOADER_UNITS ; unit++)
+	{
+		if((unit < LOADER_UNITS) && (Loader_IsPending(unit) != 0))
+		{
+			Loader_ClearPending(unit);
+			if(run == LOADER_NO_UNIT)
+			{
+				run = unit;
+			}
+			continue;
+		}
+
+		/* End of a run of marked units */
+		if(run != LOADER_NO_UNIT)
+		{
+			if(BSP_QSPI_Erase_Range(run * LOADER_UNIT_SIZE, (unit * LOADER_UNIT_SIZE) - 1) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+			run = LOADER_NO_UNIT;
+		}
+
+		/* Skip the rest of an empty bitmap word */
+		if((unit < LOADER_UNITS) && (Loader_ErasePending[unit / 32] == 0))
+		{
+			unit |= 31;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Finds the largest erase block holding a marked unit whose units
+ *          are all marked.
+ * @param   Unit     : marked unit index
+ * @param   pAddress : set to the block address
+ * @retval  Block size
+ */
+static uint32_t Loader_PendingBlock(uint32_t Unit, uint32_t *pAddress)
+{
+	static const uint32_t sizes[] = {W25Q256JW_SECTOR_SIZE, W25Q256JW_BLOCK32_SIZE};
+	uint32_t i, first, unit;
+
+	for(i = 0 ; i < (sizeof(sizes) / sizeof(sizes[0])) ; i++)
+	{
+		first = Unit & ~((sizes[i] / LOADER_UNIT_SIZE) - 1);
+		for(unit = first ; unit < first + (sizes[i] / LOADER_UNIT_SIZE) ; unit++)
+		{
+			if(Loader_IsPending(unit) == 0)
+			{
+				break;
+			}
+		}
+		if(unit == first + (sizes[i] / LOADER_UNIT_SIZE))
+		{
+			*pAddress = first * LOADER_UNIT_SIZE;
+			return sizes[i];
+		}
+	}
+
+	*pAddress = Unit * LOADER_UNIT_SIZE;
+	return LOADER_UNIT_SIZE;
+}
+
+/**
+ * @brief   Erases the largest block of marked units holding a marked unit,
+ *          unless it is already blank, and clears the marks of the block.
+ * @param   Unit       : marked unit index
+ * @param   Background : 1 to return once the erase is started, 0 to wait
+ * @param   pStarted   : set to 1 if an erase was started, 0 if blank
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_ErasePendingBlock(uint32_t Unit, uint8_t Background, uint8_t *pStarted)
+{
+	uint32_t address, size, unit;
+
+	*pStarted = 0;
+	size = Loader_PendingBlock(Unit, &address);
+	for(unit = address / LOADER_UNIT_SIZE ; unit < (address + size) / LOADER_UNIT_SIZE ; unit++)
+	{
+		Loader_ClearPending(unit);
+	}
+
+	if(Loader_MemoryMapped() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(Loader_IsBlank(address, size) != 0)
+	{
+		return QSPI_OK;
+	}
+
+	if(Loader_Indirect() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	*pStarted = 1;
+	if(Background != 0)
+	{
+		return BSP_QSPI_Erase_Block_IT(address, size);
+	}
+
+	return BSP_QSPI_Erase_Block(address, size);
+}
+
+/**
+ * @brief   Starts in the background the erase of the first marked block
+ *          that is not blank. Only one erase runs at a time: the next one
+ *          is started by the next call.
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_EraseAhead(void)
+{
+	uint32_t unit;
+	uint8_t started;
+
+	for(unit = 0 ; unit < LOADER_UNITS ; unit++)
+	{
+		/* Skip the rest of an empty bitmap word */
+		if(Loader_ErasePending[unit / 32] == 0)
+		{
+			unit |= 31;
+			continue;
+		}
+		if(Loader_IsPending(unit) == 0)
+		{
+			continue;
+		}
+
+		if(Loader_ErasePendingBlock(unit, 1, &started) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		if(started != 0)
+		{
+			break;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Erases the marked blocks the data goes to, programs the data and
+ *          starts the erase of the next marked block.
+ * @param   Address : memory address
+ * @param   Size    : size of data
+ * @param   pData   : data
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_WriteAhead(uint32_t Address, uint32_t Size, uint8_t *pData)
+{
+	uint32_t unit;
+	uint8_t started;
+
+	if(Size == 0)
+	{
+		return QSPI_OK;
+	}
+
+	for(unit = Address / LOADER_UNIT_SIZE ; unit <= (Address + Size - 1) / LOADER_UNIT_SIZE ; unit++)
+	{
+		if((Loader_IsPending(unit) != 0) && (Loader_ErasePendingBlock(unit, 0, &started) != QSPI_OK))
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	if((Loader_Indirect() != QSPI_OK) || (BSP_QSPI_Write_DMA(pData, Address, Size) != QSPI_OK))
+	{
+		return QSPI_ERROR;
+	}
+
+	return Loader_EraseAhead();
+}
+
+/**
+ * @brief   Programs data, erasing a marked block on the first data going to
+ *          it that is not blank. Blank data is not written to a marked unit,
+ *          which stays marked for Verify().
+ * @param   Address : memory address
+ * @param   Size    : size of data
+ * @param   pData   : data
+ * @retval  QSPI memory status
+ */
+static uint8_t Loader_WriteLazy(uint32_t Address, uint32_t Size, uint8_t *pData)
+{
+	uint32_t unit, chunk;
+	uint8_t started;
+
+	while(Size != 0)
+	{
+		unit = Address / LOADER_UNIT_SIZE;
+		chunk = LOADER_UNIT_SIZE - (Address % LOADER_UNIT_SIZE);
+		if(chunk > Size)
+		{
+			chunk = Size;
+		}
+
+		if((Loader_IsPending(unit) != 0) && (Loader_DataIsBlank(pData, chunk) == 0))
+		{
+			if(Loader_ErasePendingBlock(unit, 0, &started) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		if(Loader_IsPending(unit) == 0)
+		{
+			if((Loader_Indirect() != QSPI_OK) || (BSP_QSPI_Write_DMA(pData, Address, chunk) != QSPI_OK))
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		Address += chunk;
+		pData += chunk;
+		Size -= chunk;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief   Writes an unpacked frame with BSP_QSPI_Update(). The erases still
+ *          pending in its units are done first, the sweep of Verify() would
+ *          otherwise wipe the frame.
+ * @param   pData   : frame data
+ * @param   Address : memory address
+ * @param   Size    : frame size
+ * @retval  QSPI memory status
+ */
+uint8_t Loader_UpdateFrame(uint8_t *pData, uint32_t Address, uint32_t Size)
+{
+	uint32_t unit;
+	uint8_t started;
+
+	if(Size == 0)
+	{
+		return QSPI_OK;
+	}
+
+	for(unit = Address / LOADER_UNIT_SIZE ; unit <= (Address + Size - 1) / LOADER_UNIT_SIZE ; unit++)
+	{
+		if((Loader_IsPending(unit) != 0) && (Loader_ErasePendingBlock(unit, 0, &started) != QSPI_OK))
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	if(Loader_Indirect() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return BSP_QSPI_Update(pData, Address, Size);
+}
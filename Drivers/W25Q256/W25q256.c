@@ -65,6 +65,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "w25q256.h"
+#include <string.h>
 /** @addtogroup BSP
  * @{
  */
@@ -84,6 +85,73 @@
  */
 //QSPI_HandleTypeDef QSPIHandle;
 #define QSPIHandle hqspi
+
+/* Memory parameters, the defaults are replaced by the SFDP ones at init */
+static QSPI_FlashParams QSPI_Flash =
+{
+	W25Q256JW_FLASH_SIZE,
+	W25Q256JW_PAGE_SIZE,
+	{ W25Q256JW_SUBSECTOR_SIZE, W25Q256JW_BLOCK32_SIZE, W25Q256JW_SECTOR_SIZE, 0 },
+	{ W25Q256JW_SUBSECTOR_ERASE_MAX_TIME, W25Q256JW_BLOCK32_ERASE_MAX_TIME,
+		W25Q256JW_SECTOR_ERASE_MAX_TIME, 0 },
+	{ W25Q256JW_SUBSECTOR_ERASE_TYP_TIME, W25Q256JW_BLOCK32_ERASE_TYP_TIME,
+		W25Q256JW_SECTOR_ERASE_TYP_TIME, 0 },
+	{ SECTOR_ERASE_4ByteAdd_CMD, BLOCK32_ERASE_4ByteAdd_CMD, Block_ERASE_4ByteAdd_CMD, 0 },
+	W25Q256JW_BULK_ERASE_MAX_TIME,
+	QUAD_OUT_FAST_READ_CMD_4Byte_Address,
+	W25Q256JW_DUMMY_CYCLES_READ_QUAD_OUT,
+	Quad_Fast_Read_INOUT_4Byte_Address,
+	W25Q256JW_DUMMY_CYCLES_READ_QUAD,
+	2,
+	0
+};
+
+/* Driver statistics */
+static QSPI_Stats QSPI_Statistics;
+
+/* Read mode used by BSP_QSPI_Read() */
+static uint8_t QSPI_ReadMode = QSPI_READ_MODE_QUAD_INOUT;
+
+/* Set when the quad I/O reads use the DTR (DDR) protocol */
+static uint8_t QSPI_DtrMode = 0;
+
+/* Profile used by BSP_QSPI_MemoryMappedMode() */
+static uint8_t QSPI_MemoryMappedProfile = QSPI_MMAP_PROFILE_CONTINUOUS;
+
+/* Timeout of the memory-mapped mode, QSPI_MMAP_TIMEOUT_DISABLED or QUADSPI clocks */
+static uint16_t QSPI_MemoryMappedTimeout = QSPI_MMAP_TIMEOUT_DISABLED;
+
+/* Block read, merged and programmed back by BSP_QSPI_Update() */
+static uint8_t QSPI_UpdateBuffer[W25Q256JW_SUBSECTOR_SIZE] __attribute__((aligned(32)));
+
+/* Page buffers of BSP_QSPI_WriteBehind(): one is programming, the next
+ * page is staged in the other. The last page is still programming when it
+ * returns. */
+static uint8_t QSPI_BehindPage[2][W25Q256JW_PAGE_SIZE] __attribute__((aligned(32)));
+static uint32_t QSPI_BehindIndex = 0;
+static uint32_t QSPI_BehindAddr;
+static uint32_t QSPI_BehindSize = 0;
+
+/* Timeout of the erase started by BSP_QSPI_Erase_Block_IT(), 0 when none */
+static uint32_t QSPI_EraseTimeout = 0;
+
+/* Poll WEL after the WREN of each page program */
+static uint8_t QSPI_WelConfirm = 0;
+
+/* Read back and compare each page after its program */
+static uint8_t QSPI_WriteVerify = 0;
+
+/* Set while the memory may be in continuous read mode */
+static uint8_t QSPI_ContinuousRead = 0;
+
+/* Burst wrap set in the memory, QSPI_BURST_WRAP_xxx value */
+static uint8_t QSPI_BurstWrap = QSPI_BURST_WRAP_NONE;
+
+/* Status of the last non-blocking transfer: QSPI_OK, QSPI_BUSY or QSPI_ERROR */
+static volatile uint8_t QSPI_TransferStatus = QSPI_OK;
+
+/* Read stream refilled from the transfer complete callback */
+static QSPI_ReadStream *QSPI_ActiveStream = NULL;
 /**
  * @}
  */
@@ -94,8 +162,44 @@
  * @{
  */
 static uint8_t QSPI_ResetMemory(void);
+static uint8_t QSPI_ResetContinuousRead(void);
+static uint8_t QSPI_SetBurstWrap(uint8_t Wrap);
 static uint8_t QSPI_WriteEnable(void);
+static uint8_t QSPI_WriteEnableCommand(void);
+static uint8_t QSPI_ProgramEnable(void);
 static uint8_t QSPI_AutoPollingMemReady(uint32_t Timeout);
+static uint8_t QSPI_AutoPollingMemReady_IT(void);
+static void QSPI_AutoPollingMemReadyConfig(QSPI_CommandTypeDef *s_command, QSPI_AutoPollingTypeDef *s_config);
+static uint8_t QSPI_PageProgram_DMA(uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+static uint8_t QSPI_VerifyRange(const uint8_t *pData, uint32_t Address, uint32_t Size);
+static void QSPI_ReadCommandConfig(QSPI_CommandTypeDef *s_command, uint8_t ReadMode);
+static void QSPI_ServiceInterrupts(void);
+static void QSPI_StreamFill(QSPI_ReadStream *pStream);
+static uint8_t QSPI_ReceiveScatter(QSPI_ReadDesc *pDesc, uint32_t Count, uint32_t Size);
+static uint8_t QSPI_SetTiming(uint32_t ClockPrescaler, uint32_t SampleShifting);
+static uint8_t QSPI_ReadJedecId(uint8_t *pId);
+static uint8_t QSPI_CheckTiming(uint32_t ClockPrescaler, uint32_t SampleShifting, uint8_t *pId,
+								uint8_t *pPattern, uint8_t *pReference, uint8_t *pData);
+static void QSPI_CalibPattern(uint8_t *pData);
+static uint8_t QSPI_ReadCalibPattern(uint8_t *pData);
+static uint8_t QSPI_WriteCalibPattern(uint8_t *pData);
+static uint8_t QSPI_ReadCalibArea(uint8_t *pData, uint8_t ReadMode);
+static uint8_t QSPI_CalibReference(uint8_t *pReference, uint8_t *pData);
+static uint32_t QSPI_MinPrescaler(void);
+static uint8_t QSPI_LoadCalibration(void);
+static uint8_t QSPI_SaveCalibration(void);
+static uint8_t QSPI_SecurityRegCommand(uint8_t Instruction, uint32_t Address, uint32_t NbData);
+static uint32_t QSPI_Crc32(const uint8_t *pData, uint32_t Size);
+static uint8_t QSPI_DiscoverSfdp(void);
+static uint8_t QSPI_ReadSfdp(uint32_t Address, uint8_t *pData, uint32_t Size);
+static uint8_t QSPI_Opcode4Byte(uint8_t Opcode);
+static int32_t QSPI_EraseType(uint32_t Size);
+static uint8_t QSPI_IsBlank(const uint8_t *pData, uint32_t Size);
+static uint8_t QSPI_MappedIsBlank(uint32_t Address, uint32_t Size);
+static uint8_t QSPI_EraseRun(uint32_t StartAddress, uint32_t EndAddress);
+static uint8_t QSPI_EraseCommand(int32_t Type, uint32_t BlockAddress);
+static void QSPI_CleanInvalidateDCache(uint8_t *pData, uint32_t Size);
+static void QSPI_InvalidateDCache(uint8_t *pData, uint32_t Size);
 extern QSPI_HandleTypeDef QSPIHandle;
 /**
  * @}
@@ -184,6 +288,13 @@ uint8_t BSP_QSPI_QE(void)
  */
 uint8_t BSP_QSPI_Init(void)
 {
+	uint8_t status;
+
+	/* No page left programming nor erase running, lean page programs */
+	QSPI_BehindIndex = 0;
+	QSPI_BehindSize = 0;
+	QSPI_EraseTimeout = 0;
+	QSPI_WelConfirm = 0;
 
 	/* QSPI memory reset */
 	if(QSPI_ResetMemory() != QSPI_OK)
@@ -191,6 +302,12 @@ uint8_t BSP_QSPI_Init(void)
 		return QSPI_NOT_SUPPORTED;
 	}
 
+	/* Geometry and instructions, the defaults are kept without usable SFDP */
+	if(QSPI_DiscoverSfdp() == QSPI_ERROR)
+	{
+		return QSPI_ERROR;
+	}
+
 /*	if(BSP_QSPI_QE() != QSPI_OK)
 	{
 		return QSPI_ERROR;
@@ -199,6 +316,183 @@ uint8_t BSP_QSPI_Init(void)
 	{
 		return QSPI_ERROR;
 	}
+
+	/* Reuse the stored timing, sweep only when it is missing or stale */
+	status = QSPI_LoadCalibration();
+	if(status == QSPI_ERROR)
+	{
+		return QSPI_ERROR;
+	}
+	if(status != QSPI_OK)
+	{
+		if(BSP_QSPI_Calibrate() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		/* A failed save only costs a sweep at the next init */
+		QSPI_SaveCalibration();
+	}
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Selects the fastest QUADSPI clock prescaler and sample shifting
+ *         that read the memory reliably.
+ *         The JEDEC ID, the calibration pattern and the calibration area,
+ *         taken at the slowest setting, are the reference. The pattern
+ *         lives in a security register, out of the memory array, and is
+ *         read on one line. The area is read with the 1-4-4 and 1-1-4 reads
+ *         BSP_QSPI_Read() and the memory-mapped mode use. The prescaler is
+ *         swept from QSPI_CALIB_PRESCALER_MAX down to the memory clock
+ *         limit, trying both sample shiftings. If a setting fails before the
+ *         limit, the sweep stops and the setting one step slower than the
+ *         last clean one is kept as margin.
+ *         The security register is programmed with the pattern when found
+ *         erased, and ignored when it holds other data. When the area does
+ *         not toggle all four data lines the quad reads cannot be checked,
+ *         and the sweep stops at QSPI_CALIB_PRESCALER_SAFE.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Calibrate(void)
+{
+	static const uint32_t sample_shifting[2] = {QSPI_SAMPLE_SHIFTING_HALFCYCLE,
+												QSPI_SAMPLE_SHIFTING_NONE};
+	uint8_t pattern[W25Q256JW_CALIB_SIZE];
+	uint8_t reference[W25Q256JW_CALIB_SIZE];
+	uint8_t data[W25Q256JW_CALIB_SIZE];
+	uint8_t jedec_id[3];
+	uint8_t *ppattern = pattern;
+	uint8_t *preference = reference;
+	uint8_t dtr_mode = QSPI_DtrMode;
+	uint8_t failed = 0;
+	uint8_t status;
+	QSPI_Timing passed = {0xFFFFFFFF, 0};
+	QSPI_Timing margin = {0xFFFFFFFF, 0};
+	uint32_t min_prescaler, prescaler, i;
+
+	if(BSP_QSPI_EnableDTR(0) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Reference at the slowest setting */
+	if(QSPI_SetTiming(QSPI_CALIB_PRESCALER_MAX, QSPI_SAMPLE_SHIFTING_HALFCYCLE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_ReadJedecId(jedec_id) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(((jedec_id[0] == 0x00) || (jedec_id[0] == 0xFF)) && (jedec_id[1] == jedec_id[0])
+			&& (jedec_id[2] == jedec_id[0]))
+	{
+		/* Floating or shorted bus */
+		return QSPI_ERROR;
+	}
+
+	QSPI_CalibPattern(pattern);
+	if(QSPI_ReadCalibPattern(data) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+	{
+		if(data[i] != pattern[i])
+		{
+			break;
+		}
+	}
+	if(i < W25Q256JW_CALIB_SIZE)
+	{
+		for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+		{
+			if(data[i] != 0xFF)
+			{
+				break;
+			}
+		}
+		if((i < W25Q256JW_CALIB_SIZE)
+				|| (QSPI_WriteCalibPattern(pattern) != QSPI_OK)
+				|| (QSPI_CheckTiming(QSPI_CALIB_PRESCALER_MAX, QSPI_SAMPLE_SHIFTING_HALFCYCLE,
+						jedec_id, pattern, NULL, data) != QSPI_OK))
+		{
+			/* Calibrate on the JEDEC ID only */
+			ppattern = NULL;
+		}
+	}
+
+	status = QSPI_CalibReference(reference, data);
+	if(status == QSPI_ERROR)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Fastest prescaler within the memory clock limit, the bring-up one
+	 * if the quad reads cannot be checked */
+	min_prescaler = QSPI_MinPrescaler();
+	if(status != QSPI_OK)
+	{
+		preference = NULL;
+		if(min_prescaler < QSPI_CALIB_PRESCALER_SAFE)
+		{
+			min_prescaler = QSPI_CALIB_PRESCALER_SAFE;
+		}
+	}
+
+	for(prescaler = QSPI_CALIB_PRESCALER_MAX + 1 ; prescaler-- > min_prescaler ; )
+	{
+		for(i = 0 ; i < 2 ; i++)
+		{
+			if(QSPI_CheckTiming(prescaler, sample_shifting[i], jedec_id, ppattern, preference, data)
+					== QSPI_OK)
+			{
+				break;
+			}
+		}
+		if(i == 2)
+		{
+			failed = 1;
+			break;
+		}
+		margin = passed;
+		passed.ClockPrescaler = prescaler;
+		passed.SampleShifting = sample_shifting[i];
+	}
+
+	if(passed.ClockPrescaler == 0xFFFFFFFF)
+	{
+		QSPI_SetTiming(QSPI_CALIB_PRESCALER_MAX, QSPI_SAMPLE_SHIFTING_HALFCYCLE);
+		return QSPI_ERROR;
+	}
+	if((failed != 0) && (margin.ClockPrescaler != 0xFFFFFFFF))
+	{
+		passed = margin;
+	}
+
+	if(QSPI_SetTiming(passed.ClockPrescaler, passed.SampleShifting) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if((dtr_mode != 0) && (BSP_QSPI_EnableDTR(1) == QSPI_ERROR))
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns the QUADSPI timing in use.
+ * @param  pTiming: Pointer to the timing structure
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_GetTiming(QSPI_Timing *pTiming)
+{
+	pTiming->ClockPrescaler = QSPIHandle.Init.ClockPrescaler;
+	pTiming->SampleShifting = QSPIHandle.Init.SampleShifting;
+
 	return QSPI_OK;
 }
 
@@ -213,19 +507,16 @@ uint8_t BSP_QSPI_Read(uint8_t *pData , uint32_t ReadAddr , uint32_t Size)
 {
 	QSPI_CommandTypeDef s_command;
 
+	/* Linear read */
+	if(QSPI_SetBurstWrap(QSPI_BURST_WRAP_NONE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
 	/* Initialize the read command */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = READ_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
-	s_command.AddressSize = QSPI_ADDRESS_24_BITS;
+	QSPI_ReadCommandConfig(&s_command, QSPI_ReadMode);
 	s_command.Address = ReadAddr;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_1_LINE;
-	s_command.DummyCycles = 0;
 	s_command.NbData = Size;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
-	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
 
 	/* Configure the command */
 	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
@@ -244,174 +535,275 @@ uint8_t BSP_QSPI_Read(uint8_t *pData , uint32_t ReadAddr , uint32_t Size)
 }
 
 /**
- * @brief  Writes an amount of data to the QSPI memory.
- * @param  pData: Pointer to data to be written
- * @param  WriteAddr: Write start address
- * @param  Size: Size of data to write
+ * @brief  Reads the QSPI_CACHE_LINE_SIZE bytes line holding an address,
+ *         critical byte first. The memory is set to a 32-byte burst wrap
+ *         and the quad I/O read (EBh) starts at ReadAddr: the bytes up to
+ *         the end of the line come first, then the wrap brings the start of
+ *         the line. The wrap stays set until a linear read is issued.
+ * @note   The QUADSPI of this device has no wrapped memory-mapped access,
+ *         its prefetch is linear, so this is only available as an indirect
+ *         read. Without 1-4-4 SDR reads the line is read linearly.
+ * @param  pData: Destination of the line, QSPI_CACHE_LINE_SIZE bytes
+ * @param  ReadAddr: Any address in the line
  * @retval QSPI memory status
  */
-uint8_t BSP_QSPI_Write(uint8_t *pData , uint32_t WriteAddr , uint32_t Size)
+uint8_t BSP_QSPI_ReadCacheLine(uint8_t *pData , uint32_t ReadAddr)
 {
 	QSPI_CommandTypeDef s_command;
-	uint32_t end_addr, current_size, current_addr;
+	uint8_t burst[QSPI_CACHE_LINE_SIZE];
+	uint32_t offset = ReadAddr & (QSPI_CACHE_LINE_SIZE - 1);
+	uint32_t i;
 
-	/* Calculation of the size between the write address and the end of the page */
-	current_addr = 0;
+	if((QSPI_DtrMode != 0) || (QSPI_Flash.QuadInOutCmd == 0) || (QSPI_Flash.QuadInOutModeClocks != 2))
+	{
+		return BSP_QSPI_Read(pData, ReadAddr - offset, QSPI_CACHE_LINE_SIZE);
+	}
 
-	while(current_addr <= WriteAddr)
+	if(QSPI_SetBurstWrap(QSPI_BURST_WRAP_32) != QSPI_OK)
 	{
-		current_addr += W25Q256JW_PAGE_SIZE;
+		return QSPI_ERROR;
 	}
-	current_size = current_addr - WriteAddr;
 
-	/* Check if the size of the data is less than the remaining place in the page */
-	if(current_size > Size)
+	/* EBh takes the 4-byte address in 4-byte address mode */
+	QSPI_ReadCommandConfig(&s_command, QSPI_READ_MODE_QUAD_INOUT);
+	s_command.Instruction = QUAD_INOUT_FAST_READ_CMD;
+	s_command.Address = ReadAddr;
+	s_command.NbData = QSPI_CACHE_LINE_SIZE;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
 	{
-		current_size = Size;
+		return QSPI_ERROR;
 	}
 
-	/* Initialize the adress variables */
-	current_addr = WriteAddr;
-	end_addr = WriteAddr + Size;
+	if(HAL_QSPI_Receive(&QSPIHandle, burst, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
 
-	/* Initialize the program command */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = QUAD_INPUT_PAGE_PROG_4Byte_Address_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
-	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_4_LINES;
-	s_command.DummyCycles = 0;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
-	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	/* Back to line order */
+	for(i = 0 ; i < QSPI_CACHE_LINE_SIZE ; i++)
+	{
+		pData[(offset + i) & (QSPI_CACHE_LINE_SIZE - 1)] = burst[i];
+	}
 
-	/* Perform the write page by page */
-	do
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Switches the quad I/O reads of BSP_QSPI_Read() and of the
+ *         memory-mapped mode between SDR and DTR.
+ * @param  Enable: 1 to use DTR, 0 to use SDR
+ * @note   When enabling, W25Q256JW_DTR_VERIFY_SIZE bytes are read in both
+ *         modes and DTR is kept only if they match. The reference area must
+ *         not be uniform (e.g. blank) for the check to be meaningful.
+ * @note   DTR requires the QUADSPI sample shifting to be disabled. The
+ *         previous setting is restored when DTR is disabled or rejected.
+ * @retval QSPI_OK, QSPI_NOT_SUPPORTED if the memory failed the check and
+ *         SDR is still in use, QSPI_ERROR otherwise
+ */
+uint8_t BSP_QSPI_EnableDTR(uint8_t Enable)
+{
+	static uint32_t sdr_sample_shifting = QSPI_SAMPLE_SHIFTING_HALFCYCLE;
+	uint8_t sdr_data[W25Q256JW_DTR_VERIFY_SIZE];
+	uint8_t dtr_data[W25Q256JW_DTR_VERIFY_SIZE];
+	uint8_t read_mode = QSPI_ReadMode;
+	uint8_t verified = 0;
+	uint32_t i;
+
+	if(Enable == QSPI_DtrMode)
 	{
-		s_command.Address = current_addr;
-		s_command.NbData = current_size;
+		return QSPI_OK;
+	}
 
-		/* Enable write operations */
-		if(QSPI_WriteEnable() != QSPI_OK)
-		{
-			return QSPI_ERROR;
-		}
+	if(Enable == 0)
+	{
+		QSPI_DtrMode = 0;
+		return QSPI_SetTiming(QSPIHandle.Init.ClockPrescaler, sdr_sample_shifting);
+	}
 
-		/* Configure the command */
-		if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-				!= HAL_OK)
+	/* Reference read in SDR */
+	QSPI_ReadMode = QSPI_READ_MODE_QUAD_INOUT;
+	if(BSP_QSPI_Read(sdr_data, W25Q256JW_DTR_VERIFY_ADDR, W25Q256JW_DTR_VERIFY_SIZE) != QSPI_OK)
+	{
+		QSPI_ReadMode = read_mode;
+		return QSPI_ERROR;
+	}
+
+	/* Same read in DTR */
+	sdr_sample_shifting = QSPIHandle.Init.SampleShifting;
+	if(QSPI_SetTiming(QSPIHandle.Init.ClockPrescaler, QSPI_SAMPLE_SHIFTING_NONE) != QSPI_OK)
+	{
+		QSPI_ReadMode = read_mode;
+		return QSPI_ERROR;
+	}
+	QSPI_DtrMode = 1;
+	if(BSP_QSPI_Read(dtr_data, W25Q256JW_DTR_VERIFY_ADDR, W25Q256JW_DTR_VERIFY_SIZE) != QSPI_OK)
+	{
+		HAL_QSPI_Abort(&QSPIHandle);
+	}
+	else
+	{
+		/* Only a non-uniform reference that reads back identically counts */
+		for(i = 1 ; i < W25Q256JW_DTR_VERIFY_SIZE ; i++)
 		{
-			return QSPI_ERROR;
+			if(sdr_data[i] != sdr_data[0])
+			{
+				verified = 1;
+			}
 		}
-
-		/* Transmission of the data */
-		if(HAL_QSPI_Transmit(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-				!= HAL_OK)
+		for(i = 0 ; i < W25Q256JW_DTR_VERIFY_SIZE ; i++)
 		{
-			return QSPI_ERROR;
+			if(sdr_data[i] != dtr_data[i])
+			{
+				verified = 0;
+				break;
+			}
 		}
+	}
+	QSPI_ReadMode = read_mode;
 
-		/* Configure automatic polling mode to wait for end of program */
-		if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	/* Fall back to SDR */
+	if(verified == 0)
+	{
+		QSPI_DtrMode = 0;
+		if(QSPI_SetTiming(QSPIHandle.Init.ClockPrescaler, sdr_sample_shifting) != QSPI_OK)
 		{
 			return QSPI_ERROR;
 		}
-
-		/* Update the address and size variables for next page programming */
-		current_addr += current_size;
-		pData += current_size;
-		current_size =
-				((current_addr + W25Q256JW_PAGE_SIZE) > end_addr) ?
-						(end_addr - current_addr) : W25Q256JW_PAGE_SIZE;
+		return QSPI_NOT_SUPPORTED;
 	}
-	while(current_addr < end_addr);
 
 	return QSPI_OK;
 }
 
 /**
- * @brief  Erases the specified Sector of the QSPI memory.
- * @param  BlockAddress: Sector address to erase
+ * @brief  Reads a set of records scattered in the QSPI memory.
+ *         The records are sorted by address, and records closer than
+ *         QSPI_READV_MAX_GAP bytes are fetched with a single read command
+ *         whose data is spread over their destinations.
+ * @param  pDesc: Array of record descriptors, sorted in place by address
+ * @param  Count: Number of descriptors
  * @retval QSPI memory status
  */
-uint8_t BSP_QSPI_Erase_Sector(uint32_t EraseStartAddress , uint32_t EraseEndAddress)
+uint8_t BSP_QSPI_ReadVector(QSPI_ReadDesc *pDesc , uint32_t Count)
 {
 	QSPI_CommandTypeDef s_command;
-	EraseStartAddress = EraseStartAddress - EraseStartAddress % MEMORY_SECTOR_SIZE;
-	/* Initialize the erase command */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = BLOCK_ERASE_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
-	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_NONE;
-	s_command.DummyCycles = 0;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
-	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	QSPI_ReadDesc desc;
+	uint32_t first, last, i, j, end;
 
-	while(EraseEndAddress >= EraseStartAddress)
+	/* Sort the descriptors by address */
+	for(i = 1 ; i < Count ; i++)
 	{
-		s_command.Address = (EraseStartAddress & 0x0FFFFFFF);
-		/* Enable write operations */
-		if(QSPI_WriteEnable() != QSPI_OK)
+		desc = pDesc[i];
+		for(j = i ; (j > 0) && (pDesc[j - 1].Address > desc.Address) ; j--)
 		{
-			return QSPI_ERROR;
+			pDesc[j] = pDesc[j - 1];
+		}
+		pDesc[j] = desc;
+	}
+
+	/* Linear read */
+	if(QSPI_SetBurstWrap(QSPI_BURST_WRAP_NONE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Initialize the read command */
+	QSPI_ReadCommandConfig(&s_command, QSPI_ReadMode);
+
+	first = 0;
+	while(first < Count)
+	{
+		if(pDesc[first].Size == 0)
+		{
+			first++;
+			continue;
+		}
+
+		/* Extend the run over the following records that do not overlap it
+		 * and start close enough after it */
+		end = pDesc[first].Address + pDesc[first].Size;
+		for(last = first + 1 ; last < Count ; last++)
+		{
+			if((pDesc[last].Address < end) || (pDesc[last].Address > (end + QSPI_READV_MAX_GAP)))
+			{
+				break;
+			}
+			if(pDesc[last].Size != 0)
+			{
+				end = pDesc[last].Address + pDesc[last].Size;
+			}
 		}
 
-		/* Send the command */
+		s_command.Address = pDesc[first].Address;
+		s_command.NbData = end - pDesc[first].Address;
+
+		/* Configure the command */
 		if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
 				!= HAL_OK)
 		{
 			return QSPI_ERROR;
 		}
-		EraseStartAddress += MEMORY_SECTOR_SIZE;
 
-		/* Configure automatic polling mode to wait for end of erase */
-		if(QSPI_AutoPollingMemReady(W25Q256JW_SECTOR_ERASE_MAX_TIME) != QSPI_OK)
+		/* Reception of the data */
+		if(QSPI_ReceiveScatter(&pDesc[first], last - first, s_command.NbData) != QSPI_OK)
 		{
+			HAL_QSPI_Abort(&QSPIHandle);
 			return QSPI_ERROR;
 		}
+
+		first = last;
 	}
+
 	return QSPI_OK;
 }
 
 /**
- * @brief  Erases the entire QSPI memory.
+ * @brief  Starts reading an amount of data from the QSPI memory with DMA.
+ *         The function returns as soon as the transfer is started, use
+ *         BSP_QSPI_WaitForTransfer() or BSP_QSPI_ReadCpltCallback() to know
+ *         when the data is available.
+ * @param  pData: Pointer to data to be read (32-byte aligned if D-cache is on)
+ * @param  ReadAddr: Read start address
+ * @param  Size: Size of data to read
  * @retval QSPI memory status
  */
-uint8_t BSP_QSPI_Erase_Chip(void)
+uint8_t BSP_QSPI_Read_DMA(uint8_t *pData , uint32_t ReadAddr , uint32_t Size)
 {
 	QSPI_CommandTypeDef s_command;
 
-	/* Initialize the erase command */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = CHIP_ERASE_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_NONE;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_NONE;
-	s_command.DummyCycles = 0;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
-	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	if(QSPI_TransferStatus == QSPI_BUSY)
+	{
+		return QSPI_BUSY;
+	}
 
-	/* Enable write operations */
-	if(QSPI_WriteEnable() != QSPI_OK)
+	/* Linear read */
+	if(QSPI_SetBurstWrap(QSPI_BURST_WRAP_NONE) != QSPI_OK)
 	{
 		return QSPI_ERROR;
 	}
 
-	/* Send the command */
+	/* Initialize the read command */
+	QSPI_ReadCommandConfig(&s_command, QSPI_ReadMode);
+	s_command.Address = ReadAddr;
+	s_command.NbData = Size;
+
+	/* Configure the command */
 	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
 			!= HAL_OK)
 	{
 		return QSPI_ERROR;
 	}
 
-	/* Configure automatic polling mode to wait for end of erase */
-	if(QSPI_AutoPollingMemReady(W25Q256JW_BULK_ERASE_MAX_TIME) != QSPI_OK)
+	/* Make sure no dirty line of the buffer is evicted over the DMA data */
+	QSPI_CleanInvalidateDCache(pData, Size);
+
+	/* Start the reception of the data */
+	QSPI_TransferStatus = QSPI_BUSY;
+	if(HAL_QSPI_Receive_DMA(&QSPIHandle, pData) != HAL_OK)
 	{
+		QSPI_TransferStatus = QSPI_ERROR;
 		return QSPI_ERROR;
 	}
 
@@ -419,18 +811,2395 @@ uint8_t BSP_QSPI_Erase_Chip(void)
 }
 
 /**
- * @brief  Reads current status of the QSPI memory.
+ * @brief  Waits for the end of the non-blocking transfer in progress.
+ * @param  Timeout: Timeout in ms
  * @retval QSPI memory status
  */
-uint8_t BSP_QSPI_GetStatus(void)
+uint8_t BSP_QSPI_WaitForTransfer(uint32_t Timeout)
 {
-	QSPI_CommandTypeDef s_command;
-	uint8_t reg;
+	uint32_t tickstart = HAL_GetTick();
 
-	/* Initialize the read flag status register command */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = READ_STATUS_REG1_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	while(QSPI_TransferStatus == QSPI_BUSY)
+	{
+		QSPI_ServiceInterrupts();
+
+		if((HAL_GetTick() - tickstart) > Timeout)
+		{
+			HAL_QSPI_Abort(&QSPIHandle);
+			QSPI_TransferStatus = QSPI_ERROR;
+		}
+	}
+
+	return QSPI_TransferStatus;
+}
+
+/**
+ * @brief  Returns the status of the last non-blocking transfer.
+ * @retval QSPI_OK, QSPI_BUSY or QSPI_ERROR
+ */
+uint8_t BSP_QSPI_GetTransferStatus(void)
+{
+	return QSPI_TransferStatus;
+}
+
+/**
+ * @brief  Called when a BSP_QSPI_Read_DMA() transfer is complete.
+ * @note   This function should be implemented by the user if needed.
+ *         It is called from the QUADSPI interrupt, or from
+ *         BSP_QSPI_WaitForTransfer() when interrupts are masked.
+ * @retval None
+ */
+__weak void BSP_QSPI_ReadCpltCallback(void)
+{
+}
+
+/**
+ * @brief  Opens a read stream over an area of the QSPI memory and starts
+ *         fetching the first chunk. Only one stream can be open at a time,
+ *         and no other transfer may be issued until it is closed.
+ * @param  pStream: Stream to initialize
+ * @param  ReadAddr: Read start address
+ * @param  Size: Size of the area
+ * @param  pBuffers: Chunk buffers (32-byte aligned if D-cache is on)
+ * @param  NbBuffers: Number of chunk buffers, 2 to QSPI_STREAM_MAX_BUFFERS
+ * @param  ChunkSize: Size of each chunk buffer
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_StreamOpen(QSPI_ReadStream *pStream , uint32_t ReadAddr , uint32_t Size ,
+							uint8_t **pBuffers , uint32_t NbBuffers , uint32_t ChunkSize)
+{
+	uint32_t i;
+
+	if((QSPI_ActiveStream != NULL) || (NbBuffers < 2) || (NbBuffers > QSPI_STREAM_MAX_BUFFERS)
+			|| (ChunkSize == 0))
+	{
+		return QSPI_ERROR;
+	}
+
+	for(i = 0 ; i < NbBuffers ; i++)
+	{
+		pStream->pBuffer[i] = pBuffers[i];
+		pStream->Size[i] = 0;
+	}
+	pStream->NbBuffers = NbBuffers;
+	pStream->ChunkSize = ChunkSize;
+	pStream->NextAddr = ReadAddr;
+	pStream->EndAddr = ReadAddr + Size;
+	pStream->Started = 0;
+	pStream->Filled = 0;
+	pStream->Consumed = 0;
+	pStream->Released = 0;
+
+	QSPI_ActiveStream = pStream;
+	QSPI_StreamFill(pStream);
+
+	return (QSPI_TransferStatus == QSPI_ERROR) ? QSPI_ERROR : QSPI_OK;
+}
+
+/**
+ * @brief  Hands the next chunk of a read stream to the consumer.
+ *         The chunk returned by the previous call is given back to the
+ *         stream, which refills it while the new one is processed.
+ * @param  pStream: Open stream
+ * @param  pChunk: Returns the chunk address, NULL at the end of the stream
+ * @param  pSize: Returns the chunk size, 0 at the end of the stream
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_StreamNext(QSPI_ReadStream *pStream , uint8_t **pChunk , uint32_t *pSize)
+{
+	uint32_t tickstart = HAL_GetTick();
+	uint32_t index;
+
+	*pChunk = NULL;
+	*pSize = 0;
+
+	/* Give back the previous chunk and keep the ring busy */
+	pStream->Released = pStream->Consumed;
+	QSPI_StreamFill(pStream);
+
+	while(pStream->Filled == pStream->Consumed)
+	{
+		if(QSPI_TransferStatus == QSPI_ERROR)
+		{
+			return QSPI_ERROR;
+		}
+		if(pStream->Started == pStream->Consumed)
+		{
+			/* End of the stream */
+			return QSPI_OK;
+		}
+
+		QSPI_ServiceInterrupts();
+
+		if((HAL_GetTick() - tickstart) > HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	index = pStream->Consumed % pStream->NbBuffers;
+	*pChunk = pStream->pBuffer[index];
+	*pSize = pStream->Size[index];
+	pStream->Consumed++;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Closes a read stream, waiting for the chunk being fetched.
+ * @param  pStream: Open stream
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_StreamClose(QSPI_ReadStream *pStream)
+{
+	uint8_t status;
+
+	if(QSPI_ActiveStream != pStream)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* No refill may start from the callback any more */
+	pStream->EndAddr = pStream->NextAddr;
+
+	status = BSP_QSPI_WaitForTransfer(HAL_QPSI_TIMEOUT_DEFAULT_VALUE);
+	QSPI_ActiveStream = NULL;
+
+	return status;
+}
+
+/**
+ * @brief  Selects the read engine used by BSP_QSPI_Read().
+ * @param  ReadMode: QSPI_READ_MODE_SINGLE, QSPI_READ_MODE_QUAD_OUT or
+ *         QSPI_READ_MODE_QUAD_INOUT
+ * @note   The quad modes need the QE bit of status register 2 set.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_SetReadMode(uint8_t ReadMode)
+{
+	if(ReadMode > QSPI_READ_MODE_QUAD_INOUT)
+	{
+		return QSPI_ERROR;
+	}
+
+	QSPI_ReadMode = ReadMode;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns the read engine used by BSP_QSPI_Read().
+ * @retval QSPI_READ_MODE_xxx value
+ */
+uint8_t BSP_QSPI_GetReadMode(void)
+{
+	return QSPI_ReadMode;
+}
+
+/**
+ * @brief  Writes an amount of data to the QSPI memory.
+ * @param  pData: Pointer to data to be written
+ * @param  WriteAddr: Write start address
+ * @param  Size: Size of data to write
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Write(uint8_t *pData , uint32_t WriteAddr , uint32_t Size)
+{
+	QSPI_CommandTypeDef s_command;
+	uint32_t end_addr, current_size, current_addr;
+
+	/* Calculation of the size between the write address and the end of the page */
+	current_size = W25Q256JW_PAGE_SIZE - (WriteAddr & (W25Q256JW_PAGE_SIZE - 1));
+
+	/* Check if the size of the data is less than the remaining place in the page */
+	if(current_size > Size)
+	{
+		current_size = Size;
+	}
+
+	/* Initialize the adress variables */
+	current_addr = WriteAddr;
+	end_addr = WriteAddr + Size;
+
+	/* Initialize the program command */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = QUAD_INPUT_PAGE_PROG_4Byte_Address_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
+	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_4_LINES;
+	s_command.DummyCycles = 0;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	/* Perform the write page by page */
+	do
+	{
+		/* Programming 1s changes no bit, all-0xFF pages are left out */
+		if(QSPI_IsBlank(pData, current_size) != 0)
+		{
+			QSPI_Statistics.PagesSkipped++;
+
+			/* The page must already be erased */
+			if(QSPI_WriteVerify != 0)
+			{
+				if(QSPI_VerifyRange(pData, current_addr, current_size) != QSPI_OK)
+				{
+					return QSPI_VERIFY_FAILED;
+				}
+			}
+
+			current_addr += current_size;
+			pData += current_size;
+			current_size =
+					((current_addr + W25Q256JW_PAGE_SIZE) > end_addr) ?
+							(end_addr - current_addr) : W25Q256JW_PAGE_SIZE;
+			continue;
+		}
+
+		s_command.Address = current_addr;
+		s_command.NbData = current_size;
+
+		/* Enable write operations */
+		if(QSPI_ProgramEnable() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		/* Configure the command */
+		if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+				!= HAL_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		/* Transmission of the data */
+		if(HAL_QSPI_Transmit(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+				!= HAL_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		/* Configure automatic polling mode to wait for end of program */
+		if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		QSPI_Statistics.PagesProgrammed++;
+
+		/* Read the page back while its data is still in cache */
+		if(QSPI_WriteVerify != 0)
+		{
+			if(QSPI_VerifyRange(pData, current_addr, current_size) != QSPI_OK)
+			{
+				return QSPI_VERIFY_FAILED;
+			}
+		}
+
+		/* Update the address and size variables for next page programming */
+		current_addr += current_size;
+		pData += current_size;
+		current_size =
+				((current_addr + W25Q256JW_PAGE_SIZE) > end_addr) ?
+						(end_addr - current_addr) : W25Q256JW_PAGE_SIZE;
+	}
+	while(current_addr < end_addr);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Writes an amount of data to the QSPI memory, pipelined: each page
+ *         is sent by DMA and its end of program is awaited by the QUADSPI
+ *         automatic polling in interrupt mode, while the CPU prepares the
+ *         next page (blank check, D-cache clean). All-0xFF pages are left
+ *         out as in BSP_QSPI_Write(). With the write verification, the
+ *         pages are read back once their program is over, before the next
+ *         page is sent.
+ * @note   The data must stay untouched until the function returns.
+ * @param  pData: Pointer to data to be written
+ * @param  WriteAddr: Write start address
+ * @param  Size: Size of data to write
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Write_DMA(uint8_t *pData , uint32_t WriteAddr , uint32_t Size)
+{
+	uint32_t end_addr = WriteAddr + Size;
+	uint32_t current_size;
+	uint8_t *verify_data = pData;
+	uint32_t verify_addr = WriteAddr;
+
+	if(QSPI_TransferStatus == QSPI_BUSY)
+	{
+		return QSPI_BUSY;
+	}
+	QSPI_TransferStatus = QSPI_OK;
+
+	while(WriteAddr < end_addr)
+	{
+		/* Prepare the next page while the previous one programs */
+		current_size = W25Q256JW_PAGE_SIZE - (WriteAddr & (W25Q256JW_PAGE_SIZE - 1));
+		if(current_size > (end_addr - WriteAddr))
+		{
+			current_size = end_addr - WriteAddr;
+		}
+
+		if(QSPI_IsBlank(pData, current_size) != 0)
+		{
+			QSPI_Statistics.PagesSkipped++;
+		}
+		else
+		{
+			QSPI_CleanInvalidateDCache(pData, current_size);
+
+			if(BSP_QSPI_WaitForTransfer(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+
+			/* Pages done so far, the skipped ones must already be erased */
+			if(QSPI_WriteVerify != 0)
+			{
+				if(QSPI_VerifyRange(verify_data, verify_addr, WriteAddr - verify_addr) != QSPI_OK)
+				{
+					return QSPI_VERIFY_FAILED;
+				}
+				verify_data = pData;
+				verify_addr = WriteAddr;
+			}
+
+			if(QSPI_PageProgram_DMA(pData, WriteAddr, current_size) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+			QSPI_Statistics.PagesProgrammed++;
+		}
+
+		WriteAddr += current_size;
+		pData += current_size;
+	}
+
+	/* End of the last page program */
+	if(BSP_QSPI_WaitForTransfer(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_WriteVerify != 0)
+	{
+		if(QSPI_VerifyRange(verify_data, verify_addr, end_addr - verify_addr) != QSPI_OK)
+		{
+			return QSPI_VERIFY_FAILED;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Selects whether WEL is polled after the Write Enable of each page
+ *         program, as done before the lean program path. Meant for
+ *         measurements of the program overhead.
+ * @param  Enable: 1 to poll WEL, 0 to send the program right after WREN
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_SetWelConfirm(uint8_t Enable)
+{
+	QSPI_WelConfirm = (Enable != 0);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Enables the read back of each page by BSP_QSPI_Write() and
+ *         BSP_QSPI_Write_DMA(), once the memory is no more busy with it.
+ *         A mismatch stops the write with QSPI_VERIFY_FAILED.
+ * @param  Enable: 1 to verify the pages, 0 to only program them
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_SetWriteVerify(uint8_t Enable)
+{
+	QSPI_WriteVerify = (Enable != 0);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Writes an amount of data as BSP_QSPI_Write_DMA() but returns while
+ *         the last page is programming. Each page is copied to one of two
+ *         driver buffers while the previous page programs from the other,
+ *         so the data can be reused at once. The page left programming by
+ *         the previous call is awaited only once the first page is staged.
+ *         BSP_QSPI_Flush() must be called before any other access to the
+ *         memory.
+ * @note   The program goes on in the memory without the CPU, even halted;
+ *         the status and the read back of the last page are left to
+ *         BSP_QSPI_Flush(). With the write verification, the other pages
+ *         are read back once their program is over, before the next page
+ *         is sent.
+ * @param  pData: Pointer to data to be written
+ * @param  WriteAddr: Write start address
+ * @param  Size: Size of data to write
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_WriteBehind(uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
+{
+	uint32_t end_addr = WriteAddr + Size;
+	uint32_t current_size;
+	uint8_t *pbuffer;
+	uint8_t status;
+
+	/* No program before the end of a running erase */
+	if(QSPI_EraseTimeout != 0)
+	{
+		status = BSP_QSPI_Flush();
+		if(status != QSPI_OK)
+		{
+			return status;
+		}
+	}
+
+	while(WriteAddr < end_addr)
+	{
+		current_size = W25Q256JW_PAGE_SIZE - (WriteAddr & (W25Q256JW_PAGE_SIZE - 1));
+		if(current_size > (end_addr - WriteAddr))
+		{
+			current_size = end_addr - WriteAddr;
+		}
+
+		if(QSPI_IsBlank(pData, current_size) != 0)
+		{
+			QSPI_Statistics.PagesSkipped++;
+		}
+		else
+		{
+			/* Stage the page in the buffer not programming */
+			pbuffer = QSPI_BehindPage[QSPI_BehindIndex ^ 1];
+			memcpy(pbuffer, pData, current_size);
+			QSPI_CleanInvalidateDCache(pbuffer, current_size);
+
+			/* End of the page programming, and its read back */
+			status = BSP_QSPI_Flush();
+			if(status != QSPI_OK)
+			{
+				return status;
+			}
+
+			if(QSPI_PageProgram_DMA(pbuffer, WriteAddr, current_size) != QSPI_OK)
+			{
+				return QSPI_ERROR;
+			}
+			QSPI_Statistics.PagesProgrammed++;
+			QSPI_BehindIndex ^= 1;
+			QSPI_BehindAddr = WriteAddr;
+			QSPI_BehindSize = current_size;
+		}
+
+		WriteAddr += current_size;
+		pData += current_size;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Waits for the erase started by BSP_QSPI_Erase_Block_IT() and for
+ *         the page left programming by BSP_QSPI_WriteBehind(), and reads
+ *         that page back if the write verification is enabled.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Flush(void)
+{
+	uint32_t size = QSPI_BehindSize;
+	uint32_t timeout = QSPI_EraseTimeout;
+
+	if(timeout != 0)
+	{
+		QSPI_EraseTimeout = 0;
+		if(BSP_QSPI_WaitForTransfer(timeout) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	if(size == 0)
+	{
+		return QSPI_OK;
+	}
+	QSPI_BehindSize = 0;
+
+	if(BSP_QSPI_WaitForTransfer(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_WriteVerify != 0)
+	{
+		if(QSPI_VerifyRange(QSPI_BehindPage[QSPI_BehindIndex], QSPI_BehindAddr, size) != QSPI_OK)
+		{
+			return QSPI_VERIFY_FAILED;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Tells what overwriting data with new data takes. Programming can
+ *         only clear bits: new data is written over old data without erase
+ *         when (old & new) == new.
+ * @param  pOld: data in the memory
+ * @param  pNew: data to write
+ * @param  Size: data size
+ * @retval QSPI_OVERWRITE_IDENTICAL, QSPI_OVERWRITE_PROGRAM or
+ *         QSPI_OVERWRITE_ERASE
+ */
+uint8_t BSP_QSPI_ClassifyOverwrite(const uint8_t *pOld, const uint8_t *pNew, uint32_t Size)
+{
+	uint32_t diff = 0;
+	uint32_t old_word, new_word;
+
+	if((((uint32_t) pOld | (uint32_t) pNew) & 3) == 0)
+	{
+		for( ; Size >= 4 ; Size -= 4, pOld += 4, pNew += 4)
+		{
+			old_word = *(const uint32_t*) pOld;
+			new_word = *(const uint32_t*) pNew;
+			if((old_word & new_word) != new_word)
+			{
+				return QSPI_OVERWRITE_ERASE;
+			}
+			diff |= old_word ^ new_word;
+		}
+	}
+
+	for( ; Size != 0 ; Size--, pOld++, pNew++)
+	{
+		if((*pOld & *pNew) != *pNew)
+		{
+			return QSPI_OVERWRITE_ERASE;
+		}
+		diff |= *pOld ^ *pNew;
+	}
+
+	return (diff != 0) ? QSPI_OVERWRITE_PROGRAM : QSPI_OVERWRITE_IDENTICAL;
+}
+
+/**
+ * @brief  Writes data over the current content of the memory, without any
+ *         prior erase. Each 4K block of the range is read and classified:
+ *         identical blocks are left, blocks where the data only clears bits
+ *         get their differing pages programmed, the others are read, merged
+ *         with the data, erased and programmed back.
+ * @param  pData: Pointer to data to be written
+ * @param  WriteAddr: Write start address
+ * @param  Size: Size of data to write
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Update(uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
+{
+	uint32_t block, offset, current_size, end, page, page_end, run;
+
+	while(Size != 0)
+	{
+		block = WriteAddr & ~(W25Q256JW_SUBSECTOR_SIZE - 1);
+		offset = WriteAddr - block;
+		current_size = W25Q256JW_SUBSECTOR_SIZE - offset;
+		if(current_size > Size)
+		{
+			current_size = Size;
+		}
+
+		if(BSP_QSPI_Read(&QSPI_UpdateBuffer[offset], WriteAddr, current_size) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		switch(BSP_QSPI_ClassifyOverwrite(&QSPI_UpdateBuffer[offset], pData, current_size))
+		{
+			case QSPI_OVERWRITE_PROGRAM:
+				/* Program the runs of differing pages, run == end when none is open */
+				end = offset + current_size;
+				run = end;
+				for(page = offset ; page <= end ; page = page_end)
+				{
+					page_end = (page | (W25Q256JW_PAGE_SIZE - 1)) + 1;
+					if(page_end > end)
+					{
+						page_end = end;
+					}
+
+					if((page < end)
+							&& (memcmp(&QSPI_UpdateBuffer[page], &pData[page - offset], page_end - page) != 0))
+					{
+						if(run == end)
+						{
+							run = page;
+						}
+					}
+					else if(run != end)
+					{
+						if(BSP_QSPI_Write_DMA(&pData[run - offset], block + run, page - run) != QSPI_OK)
+						{
+							return QSPI_ERROR;
+						}
+						run = end;
+					}
+
+					if(page == end)
+					{
+						break;
+					}
+				}
+				break;
+
+			case QSPI_OVERWRITE_ERASE:
+				/* Keep the rest of the block across its erase */
+				if((offset != 0)
+						&& (BSP_QSPI_Read(QSPI_UpdateBuffer, block, offset) != QSPI_OK))
+				{
+					return QSPI_ERROR;
+				}
+				if(((offset + current_size) != W25Q256JW_SUBSECTOR_SIZE)
+						&& (BSP_QSPI_Read(&QSPI_UpdateBuffer[offset + current_size], WriteAddr + current_size,
+								W25Q256JW_SUBSECTOR_SIZE - offset - current_size) != QSPI_OK))
+				{
+					return QSPI_ERROR;
+				}
+				memcpy(&QSPI_UpdateBuffer[offset], pData, current_size);
+
+				if(BSP_QSPI_Erase_Block(block, W25Q256JW_SUBSECTOR_SIZE) != QSPI_OK)
+				{
+					return QSPI_ERROR;
+				}
+				QSPI_Statistics.BlocksErased++;
+				if(BSP_QSPI_Write_DMA(QSPI_UpdateBuffer, block, W25Q256JW_SUBSECTOR_SIZE) != QSPI_OK)
+				{
+					return QSPI_ERROR;
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		WriteAddr += current_size;
+		pData += current_size;
+		Size -= current_size;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Erases the sectors of the QSPI memory touching a range. The
+ *         sector is the smallest erase type, as in StorageInfo; see
+ *         BSP_QSPI_Erase_Range().
+ * @param  EraseStartAddress: First address of the range
+ * @param  EraseEndAddress: Last address of the range
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Erase_Sector(uint32_t EraseStartAddress , uint32_t EraseEndAddress)
+{
+	return BSP_QSPI_Erase_Range(EraseStartAddress, EraseEndAddress);
+}
+
+/**
+ * @brief  Erases one block of the QSPI memory with the erase type of the
+ *         given size.
+ * @param  BlockAddress: Block address, aligned on BlockSize
+ * @param  BlockSize: Size of one of the erase types (4K, 32K or 64K)
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Erase_Block(uint32_t BlockAddress, uint32_t BlockSize)
+{
+	int32_t type = QSPI_EraseType(BlockSize);
+
+	if(type < 0)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	if(QSPI_EraseCommand(type, BlockAddress) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Configure automatic polling mode to wait for end of erase */
+	if(QSPI_AutoPollingMemReady(QSPI_Flash.EraseMaxTime[type]) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Starts the erase of one block as BSP_QSPI_Erase_Block() but
+ *         returns at once. The end of the erase is polled by the QUADSPI;
+ *         BSP_QSPI_Flush() waits for it and must be called before any
+ *         other access to the memory.
+ * @note   The erase goes on in the memory without the CPU, even halted.
+ *         Only one erase can run at a time.
+ * @param  BlockAddress: Block address, aligned on BlockSize
+ * @param  BlockSize: Size of one of the erase types (4K, 32K or 64K)
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Erase_Block_IT(uint32_t BlockAddress, uint32_t BlockSize)
+{
+	int32_t type = QSPI_EraseType(BlockSize);
+
+	if(type < 0)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	/* Erase or page left by the previous call */
+	if(BSP_QSPI_Flush() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_EraseCommand(type, BlockAddress) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Let the QUADSPI poll for the end of erase */
+	if(QSPI_AutoPollingMemReady_IT() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	QSPI_EraseTimeout = QSPI_Flash.EraseMaxTime[type];
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Erases the blocks of the smallest erase type touching a range.
+ *         Blocks already blank are left out: they are checked through the
+ *         memory-mapped window first. The runs of blocks to erase are
+ *         covered with the cheapest mix of erase types, see QSPI_EraseRun().
+ *         Nothing outside these blocks is erased.
+ * @param  EraseStartAddress: First address of the range
+ * @param  EraseEndAddress: Last address of the range
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Erase_Range(uint32_t EraseStartAddress, uint32_t EraseEndAddress)
+{
+	int32_t type = -1;
+	int32_t i;
+	uint32_t size, run;
+
+	/* Smallest erase type */
+	for(i = 0 ; i < QSPI_ERASE_TYPES ; i++)
+	{
+		if((QSPI_Flash.EraseSize[i] != 0)
+				&& ((type < 0) || (QSPI_Flash.EraseSize[i] < QSPI_Flash.EraseSize[type])))
+		{
+			type = i;
+		}
+	}
+	if(type < 0)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	EraseStartAddress &= 0x0FFFFFFF;
+	EraseEndAddress &= 0x0FFFFFFF;
+	if(EraseEndAddress < EraseStartAddress)
+	{
+		return QSPI_OK;
+	}
+	size = QSPI_Flash.EraseSize[type];
+	EraseStartAddress -= EraseStartAddress % size;
+	EraseEndAddress = EraseEndAddress - (EraseEndAddress % size) + size;
+
+	while(EraseStartAddress < EraseEndAddress)
+	{
+		/* Next run of blocks that are not blank */
+		if(BSP_QSPI_MemoryMappedMode() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		while((EraseStartAddress < EraseEndAddress) && (QSPI_MappedIsBlank(EraseStartAddress, size) != 0))
+		{
+			EraseStartAddress += size;
+		}
+		run = EraseStartAddress;
+		while((EraseStartAddress < EraseEndAddress) && (QSPI_MappedIsBlank(EraseStartAddress, size) == 0))
+		{
+			EraseStartAddress += size;
+		}
+		if(BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+
+		if(QSPI_EraseRun(run, EraseStartAddress) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Erases the entire QSPI memory.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Erase_Chip(void)
+{
+	QSPI_CommandTypeDef s_command;
+
+	/* Initialize the erase command */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = CHIP_ERASE_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_NONE;
+	s_command.DummyCycles = 0;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	/* Enable write operations */
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Send the command */
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Configure automatic polling mode to wait for end of erase */
+	if(QSPI_AutoPollingMemReady(QSPI_Flash.ChipEraseMaxTime) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Reads current status of the QSPI memory.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_GetStatus(void)
+{
+	QSPI_CommandTypeDef s_command;
+	uint8_t reg;
+
+	/* Initialize the read flag status register command */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = READ_STATUS_REG1_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_1_LINE;
+	s_command.DummyCycles = 0;
+	s_command.NbData = 1;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	/* Configure the command */
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Reception of the data */
+	if(HAL_QSPI_Receive(&QSPIHandle, &reg, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Check the value of the register */
+	if((reg & W25Q256JW_FSR_BUSY) != 0)
+	{
+		return QSPI_BUSY;
+	}
+	else
+	{
+		return QSPI_OK;
+	}
+}
+
+/**
+ * @brief  Return the configuration of the QSPI memory.
+ * @param  pInfo: pointer on the configuration structure
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_GetInfo(QSPI_Info *pInfo)
+{
+	/* Configure the structure with the memory configuration */
+	/* The sector is the BSP_QSPI_Erase_Sector() unit, as in StorageInfo */
+	pInfo->FlashSize = QSPI_Flash.FlashSize;
+	pInfo->EraseSectorSize = W25Q256JW_SUBSECTOR_SIZE;
+	pInfo->EraseSectorsNumber = (QSPI_Flash.FlashSize / W25Q256JW_SUBSECTOR_SIZE);
+	pInfo->ProgPageSize = QSPI_Flash.PageSize;
+	pInfo->ProgPagesNumber = (QSPI_Flash.FlashSize / QSPI_Flash.PageSize);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Return the parameters of the QSPI memory in use.
+ * @param  pParams: pointer on the parameters structure
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_GetFlashParams(QSPI_FlashParams *pParams)
+{
+	*pParams = QSPI_Flash;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns the driver statistics.
+ * @param  pStats: pointer on the statistics structure
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_GetStats(QSPI_Stats *pStats)
+{
+	*pStats = QSPI_Statistics;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Clears the driver statistics.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_ResetStats(void)
+{
+	QSPI_Statistics.PagesProgrammed = 0;
+	QSPI_Statistics.PagesSkipped = 0;
+	QSPI_Statistics.PagesVerified = 0;
+	QSPI_Statistics.BlocksErased = 0;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Computes the CRC32 (IEEE 802.3, as zlib) of each block of the
+ *         memory in one pass through the memory-mapped window. The CRC
+ *         peripheral is fed with words and reverses them, which gives the
+ *         byte order of the software CRC32.
+ * @param  pTable: table of NbBlocks CRC32, filled from address 0
+ * @param  BlockSize: block size, a multiple of 16 bytes
+ * @param  NbBlocks: number of blocks
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Manifest(uint32_t *pTable, uint32_t BlockSize, uint32_t NbBlocks)
+{
+	const volatile uint32_t *pmem = (const volatile uint32_t*) QSPI_MMAP_BASE;
+	uint32_t block, count;
+
+	if(((BlockSize % 16) != 0) || (BlockSize == 0)
+			|| (NbBlocks > (QSPI_Flash.FlashSize / BlockSize)))
+	{
+		return QSPI_ERROR;
+	}
+
+	if(BSP_QSPI_MemoryMappedMode() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Lines cached before the last program or erase are stale */
+	QSPI_InvalidateDCache((uint8_t*) QSPI_MMAP_BASE, BlockSize * NbBlocks);
+
+	/* 32-bit polynomial 0x04C11DB7, reflected input and output */
+	__HAL_RCC_CRC_CLK_ENABLE();
+	CRC->POL = 0x04C11DB7;
+	CRC->INIT = 0xFFFFFFFF;
+	CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT;
+
+	for(block = 0 ; block < NbBlocks ; block++)
+	{
+		CRC->CR |= CRC_CR_RESET;
+		for(count = BlockSize / 16 ; count != 0 ; count--, pmem += 4)
+		{
+			CRC->DR = pmem[0];
+			CRC->DR = pmem[1];
+			CRC->DR = pmem[2];
+			CRC->DR = pmem[3];
+		}
+		pTable[block] = ~CRC->DR;
+	}
+
+	return BSP_QSPI_ExitMemoryMappedMode();
+}
+
+/**
+ * @brief  Fills a read command for the given read mode, 4-byte addressing.
+ *         Address and NbData are left to the caller.
+ * @param  s_command: command to initialize
+ * @param  ReadMode: QSPI_READ_MODE_xxx value
+ * @retval None
+ */
+static void QSPI_ReadCommandConfig(QSPI_CommandTypeDef *s_command, uint8_t ReadMode)
+{
+	s_command->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command->AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command->AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
+	s_command->AlternateBytes = W25Q256JW_MODE_BITS_NONE;
+	s_command->DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	/* Fall back to the next slower read the memory supports */
+	if((ReadMode == QSPI_READ_MODE_QUAD_INOUT) && (QSPI_Flash.QuadInOutCmd == 0))
+	{
+		ReadMode = QSPI_READ_MODE_QUAD_OUT;
+	}
+	if((ReadMode == QSPI_READ_MODE_QUAD_OUT) && (QSPI_Flash.QuadOutCmd == 0))
+	{
+		ReadMode = QSPI_READ_MODE_SINGLE;
+	}
+
+	switch(ReadMode)
+	{
+		case QSPI_READ_MODE_QUAD_INOUT:
+			/* Address and mode bits on 4 lines, M7-0 take 2 clocks */
+			s_command->Instruction = QSPI_Flash.QuadInOutCmd;
+			s_command->AddressMode = QSPI_ADDRESS_4_LINES;
+			s_command->AlternateByteMode = QSPI_ALTERNATE_BYTES_4_LINES;
+			s_command->DataMode = QSPI_DATA_4_LINES;
+			s_command->DummyCycles = QSPI_Flash.QuadInOutDummyCycles;
+			if(QSPI_Flash.QuadInOutModeClocks != 2)
+			{
+				/* No mode byte, its clocks are dummy clocks */
+				s_command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+				s_command->DummyCycles += QSPI_Flash.QuadInOutModeClocks;
+			}
+			else if(QSPI_DtrMode != 0)
+			{
+				/* Address, mode bits and data on both edges, M7-0 take 1 clock */
+				s_command->Instruction = QUAD_INOUT_DTR_READ_CMD_4Byte_Address;
+				s_command->DummyCycles = W25Q256JW_DUMMY_CYCLES_READ_QUAD_DTR;
+				s_command->DdrMode = QSPI_DDR_MODE_ENABLE;
+				s_command->DdrHoldHalfCycle = QSPI_DDR_HHC_HALF_CLK_DELAY;
+			}
+			break;
+		case QSPI_READ_MODE_QUAD_OUT:
+			s_command->Instruction = QSPI_Flash.QuadOutCmd;
+			s_command->AddressMode = QSPI_ADDRESS_1_LINE;
+			s_command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+			s_command->DataMode = QSPI_DATA_4_LINES;
+			s_command->DummyCycles = QSPI_Flash.QuadOutDummyCycles;
+			break;
+		default:
+			/* Fast read, the plain read (13h) is limited to 50 MHz */
+			s_command->Instruction = FAST_READ_CMD_4Byte_Address;
+			s_command->AddressMode = QSPI_ADDRESS_1_LINE;
+			s_command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+			s_command->DataMode = QSPI_DATA_1_LINE;
+			s_command->DummyCycles = W25Q256JW_DUMMY_CYCLES_FAST_READ;
+			break;
+	}
+}
+
+/**
+ * @brief  Receives the data of the configured read command and spreads it
+ *         over sorted, non-overlapping records. Bytes between two records
+ *         are dropped. The FIFO is drained a word at a time when possible.
+ * @param  pDesc: First record, its address is the address of the command
+ * @param  Count: Number of records covered by the command
+ * @param  Size: Number of bytes of the command
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ReceiveScatter(QSPI_ReadDesc *pDesc, uint32_t Count, uint32_t Size)
+{
+	__IO uint32_t *data_reg = &QSPIHandle.Instance->DR;
+	uint32_t tickstart = HAL_GetTick();
+	uint32_t level, word, nb, end, received = 0;
+	uint32_t skip = 0, left = pDesc->Size;
+	uint8_t *dst = pDesc->pData;
+
+	/* Start the indirect read by re-writing the address */
+	MODIFY_REG(QSPIHandle.Instance->CCR, QUADSPI_CCR_FMODE, QUADSPI_CCR_FMODE_0);
+	WRITE_REG(QSPIHandle.Instance->AR, pDesc->Address);
+
+	while(received < Size)
+	{
+		level = (READ_REG(QSPIHandle.Instance->SR) & QUADSPI_SR_FLEVEL) >> QUADSPI_SR_FLEVEL_Pos;
+		if(level == 0)
+		{
+			if((HAL_GetTick() - tickstart) > HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			{
+				return QSPI_ERROR;
+			}
+			continue;
+		}
+
+		if((level >= 4) && ((Size - received) >= 4))
+		{
+			word = *data_reg;
+			nb = 4;
+		}
+		else
+		{
+			word = *((__IO uint8_t*) data_reg);
+			nb = 1;
+		}
+		received += nb;
+
+		while(nb-- > 0)
+		{
+			if(skip != 0)
+			{
+				skip--;
+			}
+			else
+			{
+				*dst++ = (uint8_t) word;
+				if((--left == 0) && (Count > 1))
+				{
+					/* Move to the next non empty record */
+					end = pDesc->Address + pDesc->Size;
+					do
+					{
+						pDesc++;
+						Count--;
+					}
+					while((Count > 1) && (pDesc->Size == 0));
+					skip = pDesc->Address - end;
+					left = pDesc->Size;
+					dst = pDesc->pData;
+				}
+			}
+			word >>= 8;
+		}
+	}
+
+	/* Wait until TC flag is set to go back in idle state */
+	while(__HAL_QSPI_GET_FLAG(&QSPIHandle, QSPI_FLAG_TC) == RESET)
+	{
+		if((HAL_GetTick() - tickstart) > HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+		{
+			return QSPI_ERROR;
+		}
+	}
+	__HAL_QSPI_CLEAR_FLAG(&QSPIHandle, QSPI_FLAG_TC);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Lets the non-blocking transfers progress while waiting.
+ *         The flash loader runs with PRIMASK set and without a vector table,
+ *         so the QUADSPI and DMA handlers are polled from here in that case.
+ *         Otherwise the core sleeps until the next interrupt while a
+ *         transfer is in progress.
+ * @retval None
+ */
+static void QSPI_ServiceInterrupts(void)
+{
+	if(__get_PRIMASK() != 0U)
+	{
+		HAL_QSPI_IRQHandler(&QSPIHandle);
+		if(QSPIHandle.hdma != NULL)
+		{
+			HAL_DMA_IRQHandler(QSPIHandle.hdma);
+		}
+	}
+	else
+	{
+		/* Tested with interrupts masked: a completion just before WFI
+		 * leaves its interrupt pending, which still wakes the core */
+		__disable_irq();
+		if(QSPI_TransferStatus == QSPI_BUSY)
+		{
+			__DSB();
+			__WFI();
+		}
+		__enable_irq();
+	}
+}
+
+/**
+ * @brief  Starts the DMA fill of the next chunk of a read stream if the QSPI
+ *         is idle, a chunk buffer is free and data is left to fetch.
+ *         Called from the thread and from the transfer complete callback.
+ * @param  pStream: Open stream
+ * @retval None
+ */
+static void QSPI_StreamFill(QSPI_ReadStream *pStream)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t index, size;
+
+	__disable_irq();
+
+	if((QSPI_TransferStatus != QSPI_BUSY) && (pStream->NextAddr < pStream->EndAddr)
+			&& ((pStream->Started - pStream->Released) < pStream->NbBuffers))
+	{
+		index = pStream->Started % pStream->NbBuffers;
+		size = pStream->EndAddr - pStream->NextAddr;
+		if(size > pStream->ChunkSize)
+		{
+			size = pStream->ChunkSize;
+		}
+
+		pStream->Size[index] = size;
+		if(BSP_QSPI_Read_DMA(pStream->pBuffer[index], pStream->NextAddr, size) == QSPI_OK)
+		{
+			pStream->NextAddr += size;
+			pStream->Started++;
+		}
+		else
+		{
+			QSPI_TransferStatus = QSPI_ERROR;
+		}
+	}
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Changes the QUADSPI clock prescaler and sample shifting while the
+ *         peripheral is idle.
+ * @param  ClockPrescaler: QUADSPI clock = HCLK / (ClockPrescaler + 1)
+ * @param  SampleShifting: QSPI_SAMPLE_SHIFTING_NONE or QSPI_SAMPLE_SHIFTING_HALFCYCLE
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_SetTiming(uint32_t ClockPrescaler, uint32_t SampleShifting)
+{
+	uint32_t tickstart = HAL_GetTick();
+
+	while(__HAL_QSPI_GET_FLAG(&QSPIHandle, QSPI_FLAG_BUSY) != RESET)
+	{
+		if((HAL_GetTick() - tickstart) > HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	QSPIHandle.Init.ClockPrescaler = ClockPrescaler;
+	QSPIHandle.Init.SampleShifting = SampleShifting;
+	MODIFY_REG(QSPIHandle.Instance->CR, (QUADSPI_CR_PRESCALER | QUADSPI_CR_SSHIFT),
+			((ClockPrescaler << QUADSPI_CR_PRESCALER_Pos) | SampleShifting));
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Reads the 3-byte JEDEC ID (manufacturer, memory type, capacity).
+ * @param  pId: 3-byte buffer
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ReadJedecId(uint8_t *pId)
+{
+	QSPI_CommandTypeDef s_command;
+
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = READ_JEDEC_ID_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_1_LINE;
+	s_command.DummyCycles = 0;
+	s_command.NbData = 3;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(HAL_QSPI_Receive(&QSPIHandle, pId, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Applies a timing and checks that the JEDEC ID, the calibration
+ *         pattern and the calibration area read back correctly
+ *         QSPI_CALIB_PASSES times in a row. The area is read with both quad
+ *         reads.
+ * @param  ClockPrescaler: QUADSPI clock prescaler to test
+ * @param  SampleShifting: Sample shifting to test
+ * @param  pId: Reference JEDEC ID
+ * @param  pPattern: Calibration pattern, NULL if the security register is not usable
+ * @param  pReference: Calibration area content, NULL if not usable
+ * @param  pData: Scratch buffer of W25Q256JW_CALIB_SIZE bytes
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_CheckTiming(uint32_t ClockPrescaler, uint32_t SampleShifting, uint8_t *pId,
+								uint8_t *pPattern, uint8_t *pReference, uint8_t *pData)
+{
+	static const uint8_t read_mode[2] = {QSPI_READ_MODE_QUAD_INOUT, QSPI_READ_MODE_QUAD_OUT};
+	uint32_t pass, mode, i;
+
+	if(QSPI_SetTiming(ClockPrescaler, SampleShifting) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	for(pass = 0 ; pass < QSPI_CALIB_PASSES ; pass++)
+	{
+		if(QSPI_ReadJedecId(pData) != QSPI_OK)
+		{
+			HAL_QSPI_Abort(&QSPIHandle);
+			return QSPI_ERROR;
+		}
+		for(i = 0 ; i < 3 ; i++)
+		{
+			if(pData[i] != pId[i])
+			{
+				return QSPI_ERROR;
+			}
+		}
+
+		if(pPattern != NULL)
+		{
+			if(QSPI_ReadCalibPattern(pData) != QSPI_OK)
+			{
+				HAL_QSPI_Abort(&QSPIHandle);
+				return QSPI_ERROR;
+			}
+			for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+			{
+				if(pData[i] != pPattern[i])
+				{
+					return QSPI_ERROR;
+				}
+			}
+		}
+
+		if(pReference != NULL)
+		{
+			for(mode = 0 ; mode < 2 ; mode++)
+			{
+				if(QSPI_ReadCalibArea(pData, read_mode[mode]) != QSPI_OK)
+				{
+					HAL_QSPI_Abort(&QSPIHandle);
+					return QSPI_ERROR;
+				}
+				for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+				{
+					if(pData[i] != pReference[i])
+					{
+						return QSPI_ERROR;
+					}
+				}
+			}
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Builds the calibration pattern: alternating 00h/FFh, alternating
+ *         55h/AAh, walking ones and walking zeros, 1/4 of the page each.
+ * @param  pData: W25Q256JW_CALIB_SIZE bytes buffer
+ * @retval None
+ */
+static void QSPI_CalibPattern(uint8_t *pData)
+{
+	uint32_t i;
+
+	for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+	{
+		switch((i * 4) / W25Q256JW_CALIB_SIZE)
+		{
+		case 0:
+			pData[i] = (i & 1) ? 0xFF : 0x00;
+			break;
+		case 1:
+			pData[i] = (i & 1) ? 0xAA : 0x55;
+			break;
+		case 2:
+			pData[i] = (uint8_t) (1 << (i & 7));
+			break;
+		default:
+			pData[i] = (uint8_t) ~(1 << (i & 7));
+			break;
+		}
+	}
+}
+
+/**
+ * @brief  Reads the calibration pattern from its security register.
+ * @param  pData: W25Q256JW_CALIB_SIZE bytes buffer
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ReadCalibPattern(uint8_t *pData)
+{
+	if(QSPI_SecurityRegCommand(READ_SECURITY_REG_CMD, W25Q256JW_CALIB_PATTERN_ADDR, W25Q256JW_CALIB_SIZE)
+			!= QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Receive(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Programs the calibration pattern in its erased security register.
+ *         Fails if the register has been locked.
+ * @param  pData: W25Q256JW_CALIB_SIZE bytes pattern
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_WriteCalibPattern(uint8_t *pData)
+{
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_SecurityRegCommand(PROG_SECURITY_REG_CMD, W25Q256JW_CALIB_PATTERN_ADDR, W25Q256JW_CALIB_SIZE)
+			!= QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Transmit(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Reads the calibration area with a production read.
+ * @param  pData: W25Q256JW_CALIB_SIZE bytes buffer
+ * @param  ReadMode: QSPI_READ_MODE_QUAD_OUT or QSPI_READ_MODE_QUAD_INOUT
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ReadCalibArea(uint8_t *pData, uint8_t ReadMode)
+{
+	QSPI_CommandTypeDef s_command;
+
+	QSPI_ReadCommandConfig(&s_command, ReadMode);
+	s_command.Address = W25Q256JW_CALIB_READ_ADDR;
+	s_command.NbData = W25Q256JW_CALIB_SIZE;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Receive(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Takes the calibration area reference at the current timing. It
+ *         is usable if both quad reads return the same data and every data
+ *         line is seen both low and high.
+ * @param  pReference: W25Q256JW_CALIB_SIZE bytes buffer, receives the area
+ * @param  pData: Scratch buffer of W25Q256JW_CALIB_SIZE bytes
+ * @retval QSPI_OK if usable, QSPI_NOT_SUPPORTED if not, QSPI_ERROR on a
+ *         communication error
+ */
+static uint8_t QSPI_CalibReference(uint8_t *pReference, uint8_t *pData)
+{
+	uint8_t high = 0x00;
+	uint8_t low = 0xFF;
+	uint8_t toggled;
+	uint32_t i;
+
+	if((QSPI_ReadCalibArea(pReference, QSPI_READ_MODE_QUAD_INOUT) != QSPI_OK)
+			|| (QSPI_ReadCalibArea(pData, QSPI_READ_MODE_QUAD_OUT) != QSPI_OK))
+	{
+		HAL_QSPI_Abort(&QSPIHandle);
+		return QSPI_ERROR;
+	}
+
+	for(i = 0 ; i < W25Q256JW_CALIB_SIZE ; i++)
+	{
+		if(pData[i] != pReference[i])
+		{
+			return QSPI_NOT_SUPPORTED;
+		}
+		high |= pReference[i];
+		low &= pReference[i];
+	}
+
+	/* IO0-3 carry bits 0-3 and 4-7 of each byte */
+	toggled = high & ~low;
+	if(((toggled | (toggled >> 4)) & 0x0F) != 0x0F)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns the smallest prescaler keeping the QUADSPI clock within
+ *         W25Q256JW_MAX_FREQ.
+ * @retval Clock prescaler
+ */
+static uint32_t QSPI_MinPrescaler(void)
+{
+	return ((HAL_RCC_GetHCLKFreq() + W25Q256JW_MAX_FREQ - 1) / W25Q256JW_MAX_FREQ) - 1;
+}
+
+/**
+ * @brief  Applies the timing stored in the calibration record.
+ *         The record must have a valid CRC, belong to the memory in place,
+ *         match the read configuration of this build, and read the JEDEC ID
+ *         and the calibration area back correctly once applied, the area
+ *         being taken at the bring-up timing. Below QSPI_CALIB_PRESCALER_SAFE
+ *         the area must be usable.
+ * @retval QSPI_OK if applied, QSPI_NOT_SUPPORTED if the record is missing or
+ *         stale, QSPI_ERROR on a communication error
+ */
+static uint8_t QSPI_LoadCalibration(void)
+{
+	QSPI_CalibRecord record;
+	uint8_t jedec_id[3];
+	uint8_t reference[W25Q256JW_CALIB_SIZE];
+	uint8_t data[W25Q256JW_CALIB_SIZE];
+	uint8_t *preference = reference;
+	uint32_t prescaler = QSPIHandle.Init.ClockPrescaler;
+	uint32_t sample_shifting = QSPIHandle.Init.SampleShifting;
+	uint8_t status;
+	uint32_t i;
+
+	if(QSPI_ReadJedecId(jedec_id) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_SecurityRegCommand(READ_SECURITY_REG_CMD, W25Q256JW_CALIB_RECORD_ADDR, sizeof(record))
+			!= QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Receive(&QSPIHandle, (uint8_t*) &record, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if((record.Magic != QSPI_CALIB_MAGIC)
+			|| (record.Crc != QSPI_Crc32((uint8_t*) &record, sizeof(record) - sizeof(record.Crc)))
+			|| (record.DummyCycles != QSPI_Flash.QuadInOutDummyCycles)
+			|| (record.ClockPrescaler < QSPI_MinPrescaler())
+			|| (record.ClockPrescaler > QSPI_CALIB_PRESCALER_MAX)
+			|| ((record.SampleShifting != QSPI_SAMPLE_SHIFTING_NONE)
+					&& (record.SampleShifting != QSPI_SAMPLE_SHIFTING_HALFCYCLE)))
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+	for(i = 0 ; i < 3 ; i++)
+	{
+		if(record.JedecId[i] != jedec_id[i])
+		{
+			return QSPI_NOT_SUPPORTED;
+		}
+	}
+
+	status = QSPI_CalibReference(reference, data);
+	if(status == QSPI_ERROR)
+	{
+		return QSPI_ERROR;
+	}
+	if(status != QSPI_OK)
+	{
+		if(record.ClockPrescaler < QSPI_CALIB_PRESCALER_SAFE)
+		{
+			return QSPI_NOT_SUPPORTED;
+		}
+		preference = NULL;
+	}
+
+	if(QSPI_CheckTiming(record.ClockPrescaler, record.SampleShifting, jedec_id, NULL, preference, data)
+			== QSPI_OK)
+	{
+		return QSPI_OK;
+	}
+
+	/* Stale record, back to the bring-up timing */
+	if(QSPI_SetTiming(prescaler, sample_shifting) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	return QSPI_NOT_SUPPORTED;
+}
+
+/**
+ * @brief  Stores the timing in use in the calibration record.
+ *         The security register is left untouched if it already holds the
+ *         same record, and never erased unless it is blank or holds a
+ *         calibration record: other data belongs to the application, the
+ *         timing is then calibrated at every init. Fails if the register
+ *         has been locked.
+ * @retval QSPI_OK if stored, QSPI_NOT_SUPPORTED if the register holds other
+ *         data, QSPI_ERROR on a communication error
+ */
+static uint8_t QSPI_SaveCalibration(void)
+{
+	QSPI_CalibRecord record;
+	uint32_t stored[W25Q256JW_CALIB_SIZE / 4];
+	uint32_t i;
+
+	record.Magic = QSPI_CALIB_MAGIC;
+	record.ClockPrescaler = QSPIHandle.Init.ClockPrescaler;
+	record.SampleShifting = QSPIHandle.Init.SampleShifting;
+	record.DummyCycles = QSPI_Flash.QuadInOutDummyCycles;
+	if(QSPI_ReadJedecId(record.JedecId) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	record.Crc = QSPI_Crc32((uint8_t*) &record, sizeof(record) - sizeof(record.Crc));
+
+	/* The whole register, it is erased as a whole */
+	if(QSPI_SecurityRegCommand(READ_SECURITY_REG_CMD, W25Q256JW_CALIB_RECORD_ADDR, sizeof(stored))
+			!= QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Receive(&QSPIHandle, (uint8_t*) stored, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+	for(i = 0 ; i < sizeof(record) ; i++)
+	{
+		if(((uint8_t*) &record)[i] != ((uint8_t*) stored)[i])
+		{
+			break;
+		}
+	}
+	if(i == sizeof(record))
+	{
+		return QSPI_OK;
+	}
+	if((stored[0] != QSPI_CALIB_MAGIC) && (QSPI_IsBlank((uint8_t*) stored, sizeof(stored)) == 0))
+	{
+		/* Not ours */
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	/* Erase the security register */
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_SecurityRegCommand(ERASE_SECURITY_REG_CMD, W25Q256JW_CALIB_RECORD_ADDR, 0) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_AutoPollingMemReady(W25Q256JW_SUBSECTOR_ERASE_MAX_TIME) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Program the record */
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_SecurityRegCommand(PROG_SECURITY_REG_CMD, W25Q256JW_CALIB_RECORD_ADDR, sizeof(record))
+			!= QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(HAL_QSPI_Transmit(&QSPIHandle, (uint8_t*) &record, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Sends a security register erase, program or read command.
+ *         Program and read are followed by HAL_QSPI_Transmit() or
+ *         HAL_QSPI_Receive() of NbData bytes.
+ * @param  Instruction: ERASE_SECURITY_REG_CMD, PROG_SECURITY_REG_CMD or READ_SECURITY_REG_CMD
+ * @param  Address: Security register address
+ * @param  NbData: Number of data bytes, 0 for an erase
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_SecurityRegCommand(uint8_t Instruction, uint32_t Address, uint32_t NbData)
+{
+	QSPI_CommandTypeDef s_command;
+
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = Instruction;
+	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
+	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command.Address = Address;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = (NbData != 0) ? QSPI_DATA_1_LINE : QSPI_DATA_NONE;
+	s_command.DummyCycles =
+			(Instruction == READ_SECURITY_REG_CMD) ? W25Q256JW_DUMMY_CYCLES_READ_SECURITY : 0;
+	s_command.NbData = NbData;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Computes the CRC32 (IEEE 802.3, as zlib) of a buffer.
+ * @param  pData: buffer address
+ * @param  Size: buffer size
+ * @retval CRC32
+ */
+static uint32_t QSPI_Crc32(const uint8_t *pData, uint32_t Size)
+{
+	uint32_t crc = 0xFFFFFFFF;
+	uint32_t i, bit;
+
+	for(i = 0 ; i < Size ; i++)
+	{
+		crc ^= pData[i];
+		for(bit = 0 ; bit < 8 ; bit++)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc;
+}
+
+/**
+ * @brief  Reads the JEDEC basic flash parameter table and replaces the
+ *         default memory parameters with the ones it describes: density,
+ *         page size, erase types and times, 1-1-4 and 1-4-4 reads and the
+ *         4-byte address entry method. The QUADSPI flash size follows the
+ *         density.
+ * @retval QSPI_OK if applied, QSPI_NOT_SUPPORTED if the memory has no usable
+ *         table, QSPI_ERROR on a communication error
+ */
+static uint8_t QSPI_DiscoverSfdp(void)
+{
+	static const uint32_t erase_unit[4] = {1, 16, 128, 1000};
+	static const uint32_t chip_erase_unit[4] = {16, 256, 4000, 64000};
+	QSPI_FlashParams params = QSPI_Flash;
+	uint32_t header[2];
+	uint32_t bfpt[QSPI_SFDP_BFPT_DWORDS];
+	uint32_t length, field, multiplier, i;
+	uint8_t opcode;
+
+	/* SFDP header and first parameter header */
+	if(QSPI_ReadSfdp(0, (uint8_t*) header, sizeof(header)) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(header[0] != QSPI_SFDP_SIGNATURE)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+	if(QSPI_ReadSfdp(sizeof(header), (uint8_t*) header, sizeof(header)) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(((((header[1] >> 16) & 0xFF00) | (header[0] & 0xFF)) != QSPI_SFDP_BFPT_ID)
+			|| (((header[0] >> 16) & 0xFF) != 1))
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	/* Basic flash parameter table */
+	length = header[0] >> 24;
+	if(length < 9)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+	if(length > QSPI_SFDP_BFPT_DWORDS)
+	{
+		length = QSPI_SFDP_BFPT_DWORDS;
+	}
+	for(i = 0 ; i < QSPI_SFDP_BFPT_DWORDS ; i++)
+	{
+		bfpt[i] = 0;
+	}
+	if(QSPI_ReadSfdp(header[1] & 0xFFFFFF, (uint8_t*) bfpt, length * 4) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* The driver addresses the memory with 4-byte instructions */
+	if(((bfpt[0] >> 17) & 0x3) == 0)
+	{
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	/* Density, in bits */
+	if((bfpt[1] & 0x80000000) != 0)
+	{
+		field = bfpt[1] & 0x7FFFFFFF;
+		if((field < 3) || (field > 31))
+		{
+			return QSPI_NOT_SUPPORTED;
+		}
+		params.FlashSize = 1UL << (field - 3);
+	}
+	else
+	{
+		params.FlashSize = (bfpt[1] / 8) + 1;
+	}
+	if(params.FlashSize > 0x10000000)
+	{
+		/* Larger than the memory-mapped window */
+		return QSPI_NOT_SUPPORTED;
+	}
+
+	/* 1-1-4 read */
+	params.QuadOutCmd = 0;
+	if((bfpt[0] & (1UL << 22)) != 0)
+	{
+		params.QuadOutCmd = QSPI_Opcode4Byte(bfpt[2] >> 24);
+		params.QuadOutDummyCycles = ((bfpt[2] >> 16) & 0x1F) + ((bfpt[2] >> 21) & 0x7);
+	}
+
+	/* 1-4-4 read */
+	params.QuadInOutCmd = 0;
+	if((bfpt[0] & (1UL << 21)) != 0)
+	{
+		params.QuadInOutCmd = QSPI_Opcode4Byte((bfpt[2] >> 8) & 0xFF);
+		params.QuadInOutDummyCycles = bfpt[2] & 0x1F;
+		params.QuadInOutModeClocks = (bfpt[2] >> 5) & 0x7;
+	}
+
+	/* Erase types, their typical times and the max time multiplier */
+	multiplier = (length >= 10) ? (2 * ((bfpt[9] & 0xF) + 1)) : 0;
+	for(i = 0 ; i < QSPI_ERASE_TYPES ; i++)
+	{
+		field = (bfpt[7 + (i / 2)] >> ((i & 1) * 16)) & 0xFFFF;
+		opcode = QSPI_Opcode4Byte(field >> 8);
+		params.EraseSize[i] = 0;
+		params.EraseCmd[i] = opcode;
+		if(((field & 0xFF) != 0) && ((field & 0xFF) < 32) && (opcode != 0))
+		{
+			params.EraseSize[i] = 1UL << (field & 0xFF);
+		}
+		if(multiplier != 0)
+		{
+			field = (bfpt[9] >> (4 + (7 * i))) & 0x7F;
+			params.EraseTypTime[i] = ((field & 0x1F) + 1) * erase_unit[field >> 5];
+			params.EraseMaxTime[i] = params.EraseTypTime[i] * multiplier;
+		}
+		else if(params.EraseSize[i] == W25Q256JW_SUBSECTOR_SIZE)
+		{
+			/* No times in the table, datasheet figures of the size */
+			params.EraseMaxTime[i] = W25Q256JW_SUBSECTOR_ERASE_MAX_TIME;
+			params.EraseTypTime[i] = W25Q256JW_SUBSECTOR_ERASE_TYP_TIME;
+		}
+		else if(params.EraseSize[i] == W25Q256JW_BLOCK32_SIZE)
+		{
+			params.EraseMaxTime[i] = W25Q256JW_BLOCK32_ERASE_MAX_TIME;
+			params.EraseTypTime[i] = W25Q256JW_BLOCK32_ERASE_TYP_TIME;
+		}
+		else
+		{
+			params.EraseMaxTime[i] = W25Q256JW_SECTOR_ERASE_MAX_TIME;
+			params.EraseTypTime[i] = W25Q256JW_SECTOR_ERASE_TYP_TIME;
+		}
+	}
+
+	/* Page size and chip erase time */
+	if(length >= 11)
+	{
+		params.PageSize = 1UL << ((bfpt[10] >> 4) & 0xF);
+		field = (bfpt[10] >> 24) & 0x7F;
+		if(multiplier != 0)
+		{
+			params.ChipEraseMaxTime = ((field & 0x1F) + 1) * chip_erase_unit[field >> 5] * multiplier;
+		}
+	}
+
+	/* 4-byte address entry: B7h alone or after a write enable */
+	if(length >= 16)
+	{
+		field = bfpt[15] >> 24;
+		params.Enter4ByteWren = ((field & 0x01) == 0) && ((field & 0x02) != 0);
+	}
+
+	QSPI_Flash = params;
+
+	/* QUADSPI flash size, FSIZE + 1 address bits */
+	for(i = 0 ; (1UL << i) < QSPI_Flash.FlashSize ; i++)
+	{
+	}
+	QSPIHandle.Init.FlashSize = i - 1;
+	MODIFY_REG(QSPIHandle.Instance->DCR, QUADSPI_DCR_FSIZE,
+			((i - 1) << QUADSPI_DCR_FSIZE_Pos));
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Reads the SFDP area, 3-byte address and 8 dummy clocks in any
+ *         address mode.
+ * @param  Address: SFDP address
+ * @param  pData: Pointer to data to be read
+ * @param  Size: Size of data to read
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ReadSfdp(uint32_t Address, uint8_t *pData, uint32_t Size)
+{
+	QSPI_CommandTypeDef s_command;
+
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = READ_SFDP_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
+	s_command.AddressSize = QSPI_ADDRESS_24_BITS;
+	s_command.Address = Address;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_1_LINE;
+	s_command.DummyCycles = W25Q256JW_DUMMY_CYCLES_READ_SFDP;
+	s_command.NbData = Size;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(HAL_QSPI_Receive(&QSPIHandle, pData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns the 4-byte address form of a 3-byte address read or
+ *         erase instruction listed by SFDP.
+ * @param  Opcode: 3-byte address instruction
+ * @retval 4-byte address instruction, 0 if unknown
+ */
+static uint8_t QSPI_Opcode4Byte(uint8_t Opcode)
+{
+	switch(Opcode)
+	{
+		case FAST_READ_CMD:
+			return FAST_READ_CMD_4Byte_Address;
+		case QUAD_OUT_FAST_READ_CMD:
+			return QUAD_OUT_FAST_READ_CMD_4Byte_Address;
+		case QUAD_INOUT_FAST_READ_CMD:
+			return Quad_Fast_Read_INOUT_4Byte_Address;
+		case SECTOR_ERASE_CMD:
+			return SECTOR_ERASE_4ByteAdd_CMD;
+		case BLOCK32_ERASE_CMD:
+			return BLOCK32_ERASE_4ByteAdd_CMD;
+		case BLOCK64_ERASE_CMD:
+			return Block_ERASE_4ByteAdd_CMD;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * @brief  Finds the erase type of a given size.
+ * @param  Size: Erase size
+ * @retval Index in the erase tables, -1 if the memory has none of this size
+ */
+static int32_t QSPI_EraseType(uint32_t Size)
+{
+	int32_t i;
+
+	for(i = 0 ; i < QSPI_ERASE_TYPES ; i++)
+	{
+		if(QSPI_Flash.EraseSize[i] == Size)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief  Tells whether a buffer only holds 0xFF bytes. The aligned part is
+ *         checked four words per iteration.
+ * @param  pData: buffer address
+ * @param  Size: buffer size
+ * @retval 1 if blank, 0 otherwise
+ */
+static uint8_t QSPI_IsBlank(const uint8_t *pData, uint32_t Size)
+{
+	const uint32_t *pword;
+	uint32_t acc = 0xFFFFFFFF;
+
+	/* Head up to the first word boundary */
+	while((Size != 0) && (((uint32_t) pData & 3) != 0))
+	{
+		if(*pData++ != 0xFF)
+		{
+			return 0;
+		}
+		Size--;
+	}
+
+	pword = (const uint32_t*) pData;
+	while(Size >= 16)
+	{
+		acc &= pword[0] & pword[1] & pword[2] & pword[3];
+		if(acc != 0xFFFFFFFF)
+		{
+			return 0;
+		}
+		pword += 4;
+		Size -= 16;
+	}
+	while(Size >= 4)
+	{
+		acc &= *pword++;
+		Size -= 4;
+	}
+
+	pData = (const uint8_t*) pword;
+	while(Size != 0)
+	{
+		acc &= 0xFFFFFF00 | *pData++;
+		Size--;
+	}
+
+	return (acc == 0xFFFFFFFF);
+}
+
+/**
+ * @brief  Tells whether an area of the memory is erased, reading it through
+ *         the memory-mapped window eight words per iteration and stopping
+ *         at the first line holding a cleared bit. The memory-mapped mode
+ *         must be enabled.
+ * @param  Address: area address, 32-byte aligned
+ * @param  Size: area size, multiple of 32 bytes
+ * @retval 1 if blank, 0 otherwise
+ */
+static uint8_t QSPI_MappedIsBlank(uint32_t Address, uint32_t Size)
+{
+	const volatile uint32_t *pword = (const volatile uint32_t*) (QSPI_MMAP_BASE + Address);
+	uint32_t acc;
+
+	/* Lines cached before the last program are stale */
+	QSPI_InvalidateDCache((uint8_t*) (QSPI_MMAP_BASE + Address), Size);
+
+	for( ; Size != 0 ; Size -= 32, pword += 8)
+	{
+		acc = pword[0] & pword[1] & pword[2] & pword[3];
+		acc &= pword[4] & pword[5] & pword[6] & pword[7];
+		if(acc != 0xFFFFFFFF)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief  Erases a range aligned on the smallest erase type with the
+ *         cheapest mix of erase types: at each address, the type aligned
+ *         there and fitting in the range with the best typical bytes per
+ *         ms is used.
+ * @param  StartAddress: range start
+ * @param  EndAddress: range end, excluded
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_EraseRun(uint32_t StartAddress, uint32_t EndAddress)
+{
+	int32_t best, i;
+	uint32_t size;
+
+	while(StartAddress < EndAddress)
+	{
+		best = -1;
+		for(i = 0 ; i < QSPI_ERASE_TYPES ; i++)
+		{
+			size = QSPI_Flash.EraseSize[i];
+			if((size == 0) || ((StartAddress % size) != 0) || (size > (EndAddress - StartAddress)))
+			{
+				continue;
+			}
+			/* size / time above the best one */
+			if((best < 0) || (((uint64_t) size * QSPI_Flash.EraseTypTime[best])
+					> ((uint64_t) QSPI_Flash.EraseSize[best] * QSPI_Flash.EraseTypTime[i])))
+			{
+				best = i;
+			}
+		}
+		if(best < 0)
+		{
+			return QSPI_ERROR;
+		}
+
+		if(BSP_QSPI_Erase_Block(StartAddress, QSPI_Flash.EraseSize[best]) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		StartAddress += QSPI_Flash.EraseSize[best];
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Enables the write operations and sends the erase command of a
+ *         block, without waiting for the end of erase.
+ * @param  Type: Erase type index
+ * @param  BlockAddress: Block address, aligned on the erase type size
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_EraseCommand(int32_t Type, uint32_t BlockAddress)
+{
+	QSPI_CommandTypeDef s_command;
+
+	/* Initialize the erase command */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = QSPI_Flash.EraseCmd[Type];
+	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
+	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command.Address = (BlockAddress & 0x0FFFFFFF) & ~(QSPI_Flash.EraseSize[Type] - 1);
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_NONE;
+	s_command.DummyCycles = 0;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	/* Enable write operations */
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Send the command */
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Cleans and invalidates the D-cache lines covering a DMA buffer.
+ * @param  pData: buffer address
+ * @param  Size: buffer size
+ * @retval None
+ */
+static void QSPI_CleanInvalidateDCache(uint8_t *pData, uint32_t Size)
+{
+	uint32_t offset = (uint32_t) pData & 0x1FU;
+
+	if((SCB->CCR & SCB_CCR_DC_Msk) != 0U)
+	{
+		SCB_CleanInvalidateDCache_by_Addr((uint32_t*) (pData - offset), (int32_t) (Size + offset));
+	}
+}
+
+/**
+ * @brief  Invalidates the D-cache lines covering a DMA buffer or an area of
+ *         the memory-mapped window.
+ * @param  pData: buffer address
+ * @param  Size: buffer size
+ * @retval None
+ */
+static void QSPI_InvalidateDCache(uint8_t *pData, uint32_t Size)
+{
+	uint32_t offset = (uint32_t) pData & 0x1FU;
+
+	if((SCB->CCR & SCB_CCR_DC_Msk) != 0U)
+	{
+		SCB_InvalidateDCache_by_Addr((uint32_t*) (pData - offset), (int32_t) (Size + offset));
+	}
+}
+
+/**
+ * @brief  This function reset the QSPI memory.
+ * @param  hqspi: QSPI handle
+ * @retval None
+ */
+static uint8_t QSPI_ResetMemory()
+{
+	QSPI_CommandTypeDef s_command;
+
+	/* A previous session may have left the memory in continuous read mode,
+	 * where the reset instructions would be taken as an address */
+	if(QSPI_ResetContinuousRead() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_WriteEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Initialize the reset enable command */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = RESET_ENABLE_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_NONE;
+	s_command.DummyCycles = 0;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	/* Send the command */
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Send the reset memory command */
+	s_command.Instruction = RESET_MEMORY_CMD;
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+	QSPI_BurstWrap = QSPI_BURST_WRAP_NONE;
+
+	/* Configure automatic polling mode to wait the memory is ready */
+	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  This function takes the memory out of continuous read mode.
+ *         IO0-IO3 are held high for 10 clocks, which covers the 32-bit
+ *         address and the mode bits of a 4-byte quad I/O read.
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_ResetContinuousRead(void)
+{
+	QSPI_CommandTypeDef s_command;
+
+	s_command.InstructionMode = QSPI_INSTRUCTION_4_LINES;
+	s_command.Instruction = CONTINUOUS_READ_MODE_RESET_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_4_LINES;
+	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command.Address = 0xFFFFFFFF;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_NONE;
+	s_command.DummyCycles = 0;
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	QSPI_ContinuousRead = 0;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Sets the burst wrap of the quad I/O reads (Set Burst with Wrap),
+ *         if not already set: 24 dummy bits then W7-0 on 4 lines.
+ * @param  Wrap: QSPI_BURST_WRAP_xxx value
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_SetBurstWrap(uint8_t Wrap)
+{
+	QSPI_CommandTypeDef s_command;
+	uint8_t data[4] = {0x00, 0x00, 0x00, Wrap};
+
+	if(Wrap == QSPI_BurstWrap)
+	{
+		return QSPI_OK;
+	}
+
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = SET_BURST_WITH_WRAP_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command.DataMode = QSPI_DATA_4_LINES;
+	s_command.DummyCycles = 0;
+	s_command.NbData = sizeof(data);
+	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(HAL_QSPI_Transmit(&QSPIHandle, data, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	QSPI_BurstWrap = Wrap;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  This function send a Write Enable and wait it is effective.
+ * @param  hqspi: QSPI handle
+ * @retval None
+ */
+static uint8_t QSPI_WriteEnable()
+{
+	QSPI_CommandTypeDef s_command;
+	QSPI_AutoPollingTypeDef s_config;
+
+	if(QSPI_WriteEnableCommand() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Configure automatic polling mode to wait for write enabling */
+	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command.Instruction = READ_STATUS_REG1_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_NONE;
 	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
 	s_command.DataMode = QSPI_DATA_1_LINE;
 	s_command.DummyCycles = 0;
@@ -439,63 +3208,45 @@ uint8_t BSP_QSPI_GetStatus(void)
 	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
 	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
 
-	/* Configure the command */
-	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-			!= HAL_OK)
-	{
-		return QSPI_ERROR;
-	}
+	s_config.Match = W25Q256JW_FSR_WREN;
+	s_config.Mask = W25Q256JW_FSR_WREN;
+	s_config.MatchMode = QSPI_MATCH_MODE_AND;
+	s_config.StatusBytesSize = 1;
+	s_config.Interval = 0x10;
+	s_config.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
 
-	/* Reception of the data */
-	if(HAL_QSPI_Receive(&QSPIHandle, &reg, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+	if(HAL_QSPI_AutoPolling(&QSPIHandle, &s_command, &s_config, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+			!= HAL_OK)
 	{
 		return QSPI_ERROR;
 	}
 
-	/* Check the value of the register */
-	if((reg & W25Q256JW_FSR_BUSY) != 0)
-	{
-		return QSPI_BUSY;
-	}
-	else
-	{
-		return QSPI_OK;
-	}
+	return QSPI_OK;
 }
 
 /**
- * @brief  Return the configuration of the QSPI memory.
- * @param  pInfo: pointer on the configuration structure
+ * @brief  Enables the write before a page program. WEL is set when nCS
+ *         rises after WREN, and the end of the previous program was
+ *         already polled, so the WEL poll is left out unless
+ *         BSP_QSPI_SetWelConfirm() asks for it.
  * @retval QSPI memory status
  */
-uint8_t BSP_QSPI_GetInfo(QSPI_Info *pInfo)
+static uint8_t QSPI_ProgramEnable(void)
 {
-	/* Configure the structure with the memory configuration */
-	pInfo->FlashSize = W25Q256JW_FLASH_SIZE;
-	pInfo->EraseSectorSize = W25Q256JW_SUBSECTOR_SIZE;
-	pInfo->EraseSectorsNumber = (W25Q256JW_FLASH_SIZE / W25Q256JW_SUBSECTOR_SIZE);
-	pInfo->ProgPageSize = W25Q256JW_PAGE_SIZE;
-	pInfo->ProgPagesNumber = (W25Q256JW_FLASH_SIZE / W25Q256JW_PAGE_SIZE);
-
-	return QSPI_OK;
+	return (QSPI_WelConfirm != 0) ? QSPI_WriteEnable() : QSPI_WriteEnableCommand();
 }
 
 /**
- * @brief  This function reset the QSPI memory.
- * @param  hqspi: QSPI handle
- * @retval None
+ * @brief  Sends a Write Enable (06h) without waiting for WEL.
+ * @retval QSPI memory status
  */
-static uint8_t QSPI_ResetMemory()
+static uint8_t QSPI_WriteEnableCommand(void)
 {
 	QSPI_CommandTypeDef s_command;
-	if(QSPI_WriteEnable() != QSPI_OK)
-	{
-		return QSPI_ERROR;
-	}
 
-	/* Initialize the reset enable command */
+	/* Enable write operations */
 	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = RESET_ENABLE_CMD;
+	s_command.Instruction = WRITE_ENABLE_CMD;
 	s_command.AddressMode = QSPI_ADDRESS_NONE;
 	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
 	s_command.DataMode = QSPI_DATA_NONE;
@@ -503,29 +3254,50 @@ static uint8_t QSPI_ResetMemory()
 	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
 	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
 	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
-	/* Send the command */
+
 	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
 			!= HAL_OK)
 	{
 		return QSPI_ERROR;
 	}
 
-	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
-	{
-		return QSPI_ERROR;
-	}
+	return QSPI_OK;
+}
 
-	/* Send the reset memory command */
-	s_command.Instruction = RESET_MEMORY_CMD;
-	if(HAL_QSPI_Command(&QSPIHandle, &s_command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-			!= HAL_OK)
+/**
+ * @brief  This function read the SR of the memory and wait the EOP.
+ *         The QUADSPI polls the SR in interrupt mode, the core sleeps in
+ *         the meantime (or services the handlers in the flash loader).
+ * @param  Timeout
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_AutoPollingMemReady(uint32_t Timeout)
+{
+	if(QSPI_AutoPollingMemReady_IT() != QSPI_OK)
 	{
 		return QSPI_ERROR;
 	}
 
-	/* Configure automatic polling mode to wait the memory is ready */
-	if(QSPI_AutoPollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	return BSP_QSPI_WaitForTransfer(Timeout);
+}
+
+/**
+ * @brief  Starts the automatic polling of the SR in interrupt mode.
+ *         HAL_QSPI_StatusMatchCallback() marks the transfer as complete
+ *         once the memory is ready.
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_AutoPollingMemReady_IT(void)
+{
+	QSPI_CommandTypeDef s_command;
+	QSPI_AutoPollingTypeDef s_config;
+
+	QSPI_AutoPollingMemReadyConfig(&s_command, &s_config);
+
+	QSPI_TransferStatus = QSPI_BUSY;
+	if(HAL_QSPI_AutoPolling_IT(&QSPIHandle, &s_command, &s_config) != HAL_OK)
 	{
+		QSPI_TransferStatus = QSPI_ERROR;
 		return QSPI_ERROR;
 	}
 
@@ -533,22 +3305,62 @@ static uint8_t QSPI_ResetMemory()
 }
 
 /**
- * @brief  This function send a Write Enable and wait it is effective.
- * @param  hqspi: QSPI handle
+ * @brief  Fills the automatic polling command and configuration waiting for
+ *         the BUSY bit of the SR to clear.
+ * @param  s_command: command to initialize
+ * @param  s_config: automatic polling configuration to initialize
  * @retval None
  */
-static uint8_t QSPI_WriteEnable()
+static void QSPI_AutoPollingMemReadyConfig(QSPI_CommandTypeDef *s_command, QSPI_AutoPollingTypeDef *s_config)
+{
+	/* Configure automatic polling mode to wait for memory ready */
+	s_command->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	s_command->Instruction = READ_STATUS_REG1_CMD;
+	s_command->AddressMode = QSPI_ADDRESS_NONE;
+	s_command->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	s_command->DataMode = QSPI_DATA_1_LINE;
+	s_command->DummyCycles = 0;
+	s_command->DdrMode = QSPI_DDR_MODE_DISABLE;
+	s_command->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	s_command->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+
+	s_config->Match = 0x00;
+	s_config->Mask = W25Q256JW_FSR_BUSY;
+	s_config->MatchMode = QSPI_MATCH_MODE_AND;
+	s_config->StatusBytesSize = 1;
+	s_config->Interval = 0x10;
+	s_config->AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+}
+
+/**
+ * @brief  Starts the program of one page: write enable and quad input page
+ *         program command, then the data by DMA. HAL_QSPI_TxCpltCallback()
+ *         chains the automatic polling for the end of program.
+ * @param  pData: Pointer to data to be written, cleaned from the D-cache
+ * @param  WriteAddr: Write start address
+ * @param  Size: Size of data to write, within one page
+ * @retval QSPI memory status
+ */
+static uint8_t QSPI_PageProgram_DMA(uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
 {
 	QSPI_CommandTypeDef s_command;
-	QSPI_AutoPollingTypeDef s_config;
 
 	/* Enable write operations */
+	if(QSPI_ProgramEnable() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	/* Initialize the program command */
 	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = WRITE_ENABLE_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_NONE;
+	s_command.Instruction = QUAD_INPUT_PAGE_PROG_4Byte_Address_CMD;
+	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
+	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
+	s_command.Address = WriteAddr;
 	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_NONE;
+	s_command.DataMode = QSPI_DATA_4_LINES;
 	s_command.DummyCycles = 0;
+	s_command.NbData = Size;
 	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
 	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
 	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
@@ -559,21 +3371,11 @@ static uint8_t QSPI_WriteEnable()
 		return QSPI_ERROR;
 	}
 
-	/* Configure automatic polling mode to wait for write enabling */
-	s_config.Match = W25Q256JW_FSR_WREN;
-	s_config.Mask = W25Q256JW_FSR_WREN;
-	s_config.MatchMode = QSPI_MATCH_MODE_AND;
-	s_config.StatusBytesSize = 1;
-	s_config.Interval = 0x10;
-	s_config.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
-
-	s_command.Instruction = READ_STATUS_REG1_CMD;
-	s_command.DataMode = QSPI_DATA_1_LINE;
-	s_command.NbData = 1;
-
-	if(HAL_QSPI_AutoPolling(&QSPIHandle, &s_command, &s_config, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-			!= HAL_OK)
+	/* Start the transmission of the data */
+	QSPI_TransferStatus = QSPI_BUSY;
+	if(HAL_QSPI_Transmit_DMA(&QSPIHandle, pData) != HAL_OK)
 	{
+		QSPI_TransferStatus = QSPI_ERROR;
 		return QSPI_ERROR;
 	}
 
@@ -581,67 +3383,160 @@ static uint8_t QSPI_WriteEnable()
 }
 
 /**
- * @brief  This function read the SR of the memory and wait the EOP.
- * @param  hqspi: QSPI handle
- * @param  Timeout
- * @retval None
+ * @brief  Reads a programmed range back with the current read mode and
+ *         compares it with the data sent, one page at a time.
+ * @param  pData: data programmed
+ * @param  Address: range address
+ * @param  Size: range size
+ * @retval QSPI_OK if equal, QSPI_ERROR otherwise
  */
-static uint8_t QSPI_AutoPollingMemReady(uint32_t Timeout)
+static uint8_t QSPI_VerifyRange(const uint8_t *pData, uint32_t Address, uint32_t Size)
 {
-	QSPI_CommandTypeDef s_command;
-	QSPI_AutoPollingTypeDef s_config;
+	uint32_t buffer[W25Q256JW_PAGE_SIZE / 4];
+	uint32_t current_size;
 
-	/* Configure automatic polling mode to wait for memory ready */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = READ_STATUS_REG1_CMD;
-	s_command.AddressMode = QSPI_ADDRESS_NONE;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_1_LINE;
-	s_command.DummyCycles = 0;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
-	s_command.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+	while(Size != 0)
+	{
+		current_size = W25Q256JW_PAGE_SIZE - (Address & (W25Q256JW_PAGE_SIZE - 1));
+		if(current_size > Size)
+		{
+			current_size = Size;
+		}
 
-	s_config.Match = 0x00;
-	s_config.Mask = W25Q256JW_FSR_BUSY;
-	s_config.MatchMode = QSPI_MATCH_MODE_AND;
-	s_config.StatusBytesSize = 1;
-	s_config.Interval = 0x10;
-	s_config.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+		if(BSP_QSPI_Read((uint8_t*) buffer, Address, current_size) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+		if(memcmp(buffer, pData, current_size) != 0)
+		{
+			return QSPI_ERROR;
+		}
+		QSPI_Statistics.PagesVerified++;
 
-	if(HAL_QSPI_AutoPolling(&QSPIHandle, &s_command, &s_config, Timeout) != HAL_OK)
-	{
-		return QSPI_ERROR;
+		Address += current_size;
+		pData += current_size;
+		Size -= current_size;
 	}
 
 	return QSPI_OK;
 }
 
+/**
+ * @brief  Configure the QSPI in memory-mapped mode with the selected profile.
+ * @retval QSPI memory status
+ */
 uint8_t BSP_QSPI_MemoryMappedMode(void)
 {
 	QSPI_CommandTypeDef s_command;
 	QSPI_MemoryMappedTypeDef s_mem_mapped_cfg;
+	uint8_t continuous = (QSPI_MemoryMappedProfile == QSPI_MMAP_PROFILE_CONTINUOUS)
+			&& (QSPI_Flash.QuadInOutCmd != 0) && (QSPI_Flash.QuadInOutModeClocks == 2);
+
+	/* Leave a previous mapping first, the profile may have changed */
+	if(HAL_QSPI_GetState(&QSPIHandle) == HAL_QSPI_STATE_BUSY_MEM_MAPPED)
+	{
+		if(BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	/* The prefetch is linear */
+	if(QSPI_SetBurstWrap(QSPI_BURST_WRAP_NONE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
 
 	/* Configure the command for the read instruction */
-	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
-	s_command.Instruction = QUAD_OUT_FAST_READ_CMD_4Byte_Address;
-	s_command.AddressMode = QSPI_ADDRESS_1_LINE;
-	s_command.AddressSize = QSPI_ADDRESS_32_BITS;
-	s_command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-	s_command.DataMode = QSPI_DATA_4_LINES;
-	s_command.DummyCycles = 8;
-	s_command.DdrMode = QSPI_DDR_MODE_DISABLE;
-	s_command.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	if(continuous != 0)
+	{
+		/* The mode bits keep the memory in continuous read mode, so only the
+		 * first access carries the instruction */
+		QSPI_ReadCommandConfig(&s_command, QSPI_READ_MODE_QUAD_INOUT);
+		s_command.AlternateBytes = W25Q256JW_MODE_BITS_CONTINUOUS;
+		s_command.SIOOMode = QSPI_SIOO_INST_ONLY_FIRST_CMD;
+	}
+	else
+	{
+		QSPI_ReadCommandConfig(&s_command, QSPI_READ_MODE_QUAD_OUT);
+	}
 
 	/* Configure the memory mapped mode */
-	s_mem_mapped_cfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
-	s_mem_mapped_cfg.TimeOutPeriod = 0;
+	s_mem_mapped_cfg.TimeOutActivation = (QSPI_MemoryMappedTimeout == QSPI_MMAP_TIMEOUT_DISABLED) ?
+			QSPI_TIMEOUT_COUNTER_DISABLE : QSPI_TIMEOUT_COUNTER_ENABLE;
+	s_mem_mapped_cfg.TimeOutPeriod = QSPI_MemoryMappedTimeout;
 
 	if(HAL_QSPI_MemoryMapped(&QSPIHandle, &s_command, &s_mem_mapped_cfg) != HAL_OK)
 	{
 		return QSPI_ERROR;
 	}
 
+	QSPI_ContinuousRead = continuous;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Leaves the memory-mapped mode so indirect commands can be issued.
+ *         The memory is taken out of continuous read mode if needed.
+ * @note   The QUADSPI is always aborted, even when the timeout counter has
+ *         released nCS: a speculative load of the window would otherwise
+ *         start a new memory-mapped read under the next command.
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_ExitMemoryMappedMode(void)
+{
+	if(HAL_QSPI_Abort(&QSPIHandle) != HAL_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	if(QSPI_ContinuousRead != 0)
+	{
+		if(QSPI_ResetContinuousRead() != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Selects the profile used by the next BSP_QSPI_MemoryMappedMode().
+ * @param  Profile: QSPI_MMAP_PROFILE_QUAD_OUT or QSPI_MMAP_PROFILE_CONTINUOUS
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_SetMemoryMappedProfile(uint8_t Profile)
+{
+	if(Profile > QSPI_MMAP_PROFILE_CONTINUOUS)
+	{
+		return QSPI_ERROR;
+	}
+
+	QSPI_MemoryMappedProfile = Profile;
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Sets the timeout of the memory-mapped mode. The memory-mapped
+ *         mode is entered again if active.
+ * @param  Period: QSPI_MMAP_TIMEOUT_DISABLED to hold nCS low until the next
+ *         access, otherwise the number of QUADSPI clocks after which an
+ *         unused prefetch stops and nCS is released, letting the memory
+ *         go to standby
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_SetMemoryMappedTimeout(uint16_t Period)
+{
+	QSPI_MemoryMappedTimeout = Period;
+
+	if(HAL_QSPI_GetState(&QSPIHandle) == HAL_QSPI_STATE_BUSY_MEM_MAPPED)
+	{
+		return BSP_QSPI_MemoryMappedMode();
+	}
+
 	return QSPI_OK;
 }
 
@@ -649,6 +3544,11 @@ uint8_t BSP_QSPI_Enter4ByteAddrMode(void)
 {
 	QSPI_CommandTypeDef s_command;
 
+	if((QSPI_Flash.Enter4ByteWren != 0) && (QSPI_WriteEnable() != QSPI_OK))
+	{
+		return QSPI_ERROR;
+	}
+
 	/* Initialize the read flag status register command */
 	s_command.InstructionMode = QSPI_INSTRUCTION_1_LINE;
 	s_command.Instruction = Address_4Byte_Mode_CMD;
@@ -676,6 +3576,62 @@ uint8_t BSP_QSPI_Enter4ByteAddrMode(void)
 	return QSPI_OK;
 }
 
+/**
+ * @brief  Rx Transfer completed callback.
+ * @param  qspiHandle: QSPI handle
+ * @retval None
+ */
+void HAL_QSPI_RxCpltCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	QSPI_InvalidateDCache(qspiHandle->pRxBuffPtr, qspiHandle->RxXferSize);
+	QSPI_TransferStatus = QSPI_OK;
+
+	if(QSPI_ActiveStream != NULL)
+	{
+		QSPI_ActiveStream->Filled++;
+		QSPI_StreamFill(QSPI_ActiveStream);
+	}
+
+	BSP_QSPI_ReadCpltCallback();
+}
+
+/**
+ * @brief  Tx Transfer completed callback: the page is in the memory, wait
+ *         for the end of its program.
+ * @param  qspiHandle: QSPI handle
+ * @retval None
+ */
+void HAL_QSPI_TxCpltCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	(void) qspiHandle;
+
+	QSPI_AutoPollingMemReady_IT();
+}
+
+/**
+ * @brief  Status match callback: the memory is ready.
+ * @param  qspiHandle: QSPI handle
+ * @retval None
+ */
+void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	(void) qspiHandle;
+
+	QSPI_TransferStatus = QSPI_OK;
+}
+
+/**
+ * @brief  Transfer error callback.
+ * @param  qspiHandle: QSPI handle
+ * @retval None
+ */
+void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	(void) qspiHandle;
+
+	QSPI_TransferStatus = QSPI_ERROR;
+}
+
 /**
  * @}
  */
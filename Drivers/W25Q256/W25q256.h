@@ -1,3 +1,6 @@
+#ifndef W25Q256_H_
+#define W25Q256_H_
+
 #include "stm32F7xx_hal.h"
 #include "main.h"
 
@@ -11,11 +14,33 @@
 #define W25Q256JW_PAGE_SIZE                   MEMORY_PAGE_SIZE     /* 65536 pages of 256 bytes */
 
 #define W25Q256JW_DUMMY_CYCLES_READ           4
-#define W25Q256JW_DUMMY_CYCLES_READ_QUAD      10
+#define W25Q256JW_DUMMY_CYCLES_FAST_READ      8     /* 1-1-1: 8 dummy clocks */
+#define W25Q256JW_DUMMY_CYCLES_READ_QUAD      4     /* 1-4-4: 4 dummy clocks after the 2 mode bit clocks */
+#define W25Q256JW_DUMMY_CYCLES_READ_QUAD_OUT  8     /* 1-1-4: 8 dummy clocks */
+#define W25Q256JW_DUMMY_CYCLES_READ_QUAD_DTR  7     /* 1-4-4 DTR: 7 dummy clocks after the 1 mode bit clock */
+
+#define W25Q256JW_DTR_VERIFY_ADDR             0x0   /* area read back in SDR and DTR before DTR is kept */
+#define W25Q256JW_DTR_VERIFY_SIZE             256
+
+#define W25Q256JW_MAX_FREQ                    133000000 /* highest clock of the SDR read instructions, Hz */
+#define W25Q256JW_CALIB_SIZE                  W25Q256JW_PAGE_SIZE
+#define W25Q256JW_CALIB_RECORD_ADDR           0x00001000 /* security register 1, holds the calibration record */
+#define W25Q256JW_CALIB_PATTERN_ADDR          0x00002000 /* security register 2, holds the timing calibration pattern */
+#define W25Q256JW_CALIB_READ_ADDR             0x0   /* area read back with the quad reads during the calibration */
+#define W25Q256JW_DUMMY_CYCLES_READ_SECURITY  8
+#define W25Q256JW_DUMMY_CYCLES_READ_SFDP      8
+#define W25Q256JW_BLOCK32_SIZE                0x8000    /* 1024 blocks of 32kBytes */
+
+#define W25Q256JW_MODE_BITS_NONE              0xFF  /* M5-4 != 10b : no continuous read */
+#define W25Q256JW_MODE_BITS_CONTINUOUS        0x20  /* M5-4 = 10b : continuous read, next access skips the instruction */
 
 #define W25Q256JW_BULK_ERASE_MAX_TIME         250000
 #define W25Q256JW_SECTOR_ERASE_MAX_TIME       3000
 #define W25Q256JW_SUBSECTOR_ERASE_MAX_TIME    1000
+#define W25Q256JW_BLOCK32_ERASE_MAX_TIME      1600
+#define W25Q256JW_SECTOR_ERASE_TYP_TIME       150
+#define W25Q256JW_SUBSECTOR_ERASE_TYP_TIME    45
+#define W25Q256JW_BLOCK32_ERASE_TYP_TIME      120
 
 /** 
  * @brief  W25Q256JW Commands
@@ -26,22 +51,29 @@
 
 #define ENTER_QPI_MODE_CMD                   0x38
 #define EXIT_QPI_MODE_CMD                    0xFF
+#define CONTINUOUS_READ_MODE_RESET_CMD       0xFF
 
 /* Identification Operations */
 #define READ_ID_CMD                          0x90
 #define DUAL_READ_ID_CMD                     0x92
 #define QUAD_READ_ID_CMD                     0x94
 #define READ_JEDEC_ID_CMD                    0x9F
+#define READ_SFDP_CMD                        0x5A
 
 /* Read Operations */
 #define READ_CMD                             0x03
+#define READ_4Byte_Address_CMD               0x13
 #define FAST_READ_CMD                        0x0B
+#define FAST_READ_CMD_4Byte_Address          0x0C
 #define DUAL_OUT_FAST_READ_CMD               0x3B
 #define DUAL_INOUT_FAST_READ_CMD             0xBB
 #define QUAD_OUT_FAST_READ_CMD               0x6B
 #define QUAD_OUT_FAST_READ_CMD_4Byte_Address 0x6C
 #define QUAD_INOUT_FAST_READ_CMD             0xEB
 #define Quad_Fast_Read_INOUT_4Byte_Address   0xEC
+#define QUAD_INOUT_DTR_READ_CMD              0xED
+#define QUAD_INOUT_DTR_READ_CMD_4Byte_Address 0xEE
+#define SET_BURST_WITH_WRAP_CMD              0x77
 
 /* Write Operations */
 #define WRITE_ENABLE_CMD                     0x06
@@ -65,9 +97,18 @@
 /* Erase Operations */
 #define SECTOR_ERASE_CMD                     0x20
 #define BLOCK_ERASE_CMD                      0xDC
+#define BLOCK32_ERASE_CMD                    0x52
+#define BLOCK64_ERASE_CMD                    0xD8
+#define SECTOR_ERASE_4ByteAdd_CMD            0x21
+#define BLOCK32_ERASE_4ByteAdd_CMD           0x5C
 #define CHIP_ERASE_CMD                       0xC7
 #define Block_ERASE_4ByteAdd_CMD             0xDC
 
+/* Security Register Operations */
+#define ERASE_SECURITY_REG_CMD               0x44
+#define PROG_SECURITY_REG_CMD                0x42
+#define READ_SECURITY_REG_CMD                0x48
+
 #define PROG_ERASE_RESUME_CMD                0x7A
 #define PROG_ERASE_SUSPEND_CMD               0x75
 
@@ -90,12 +131,71 @@
 #define QSPI_BUSY          ((uint8_t)0x02)
 #define QSPI_NOT_SUPPORTED ((uint8_t)0x04)
 #define QSPI_SUSPENDED     ((uint8_t)0x08)
+#define QSPI_VERIFY_FAILED ((uint8_t)0x10)
+
+/* QSPI read modes used by BSP_QSPI_Read() */
+#define QSPI_READ_MODE_SINGLE      ((uint8_t)0x00)   /* 1-1-1, 0Ch */
+#define QSPI_READ_MODE_QUAD_OUT    ((uint8_t)0x01)   /* 1-1-4, 6Ch */
+#define QSPI_READ_MODE_QUAD_INOUT  ((uint8_t)0x02)   /* 1-4-4, ECh */
+
+/* QSPI memory-mapped profiles used by BSP_QSPI_MemoryMappedMode() */
+#define QSPI_MMAP_PROFILE_QUAD_OUT    ((uint8_t)0x00)   /* 1-1-4, 6Ch, instruction on every access */
+#define QSPI_MMAP_PROFILE_CONTINUOUS  ((uint8_t)0x01)   /* 1-4-4, ECh, continuous read, instruction once */
+
+/* QSPI memory-mapped timeout, in QUADSPI clocks of nCS held low without an
+ * access before the prefetch stops and nCS is released. Starting points to
+ * tune with BSP_QSPI_Bench_MemoryMapped() */
+#define QSPI_MMAP_TIMEOUT_DISABLED    0       /* nCS held low until the next access, lowest sequential latency */
+#define QSPI_MMAP_TIMEOUT_XIP         32      /* code fetch: short bursts, release early so the memory idles */
+#define QSPI_MMAP_TIMEOUT_SCAN        1024    /* table scans: ride over the gaps between consecutive loads */
 
 /* W25Q256JW Micron memory */
 /* Size of the flash */
-#define QSPI_FLASH_SIZE            23     /* Address bus width to access whole memory space */
+#define QSPI_FLASH_SIZE            24     /* FSIZE: the memory holds 2^(QSPI_FLASH_SIZE + 1) bytes */
 #define QSPI_PAGE_SIZE             256
 
+/* Timing calibration: slowest prescaler of the sweep, also the reference
+ * setting, fastest prescaler when the quad reads cannot be checked, and
+ * number of clean reads required at each setting */
+#define QSPI_CALIB_PRESCALER_MAX   7
+#define QSPI_CALIB_PRESCALER_SAFE  2
+#define QSPI_CALIB_PASSES          4
+#define QSPI_CALIB_MAGIC           0x4C414351 /* "QCAL" */
+
+/* SFDP: signature, basic flash parameter table ID and number of its
+ * DWORDs used (up to the 4-byte address entry methods) */
+#define QSPI_SFDP_SIGNATURE        0x50444653 /* "SFDP" */
+#define QSPI_SFDP_BFPT_ID          0xFF00
+#define QSPI_SFDP_BFPT_DWORDS      16
+
+/* Number of erase types described by SFDP */
+#define QSPI_ERASE_TYPES           4
+
+/* Set Burst with Wrap W7-0 values: W4 = 0 enables the wrap, W6-5 select its length */
+#define QSPI_BURST_WRAP_NONE       ((uint8_t)0x10)
+#define QSPI_BURST_WRAP_8          ((uint8_t)0x00)
+#define QSPI_BURST_WRAP_16         ((uint8_t)0x20)
+#define QSPI_BURST_WRAP_32         ((uint8_t)0x40)
+#define QSPI_BURST_WRAP_64         ((uint8_t)0x60)
+
+/* Cortex-M7 D-cache line, read by BSP_QSPI_ReadCacheLine() */
+#define QSPI_CACHE_LINE_SIZE       32
+
+/* Classes of BSP_QSPI_ClassifyOverwrite() */
+#define QSPI_OVERWRITE_IDENTICAL   ((uint8_t)0x00)   /* nothing to do */
+#define QSPI_OVERWRITE_PROGRAM     ((uint8_t)0x01)   /* only 1 -> 0 bits, program without erase */
+#define QSPI_OVERWRITE_ERASE       ((uint8_t)0x02)   /* some 0 -> 1 bits, erase first */
+
+/* Memory-mapped window of the QUADSPI */
+#define QSPI_MMAP_BASE             0x90000000
+
+/* Largest number of chunk buffers of a read stream */
+#define QSPI_STREAM_MAX_BUFFERS    4
+
+/* Largest hole read and dropped by BSP_QSPI_ReadVector() to merge two ranges,
+ * about the cost of a new 1-4-4 command header */
+#define QSPI_READV_MAX_GAP         16
+
 /**
  * @}
  */
@@ -114,6 +214,76 @@ typedef struct
 	uint32_t ProgPagesNumber; /*!< Number of pages for the program operation */
 } QSPI_Info;
 
+/* QSPI memory parameters, taken from SFDP at init when available */
+typedef struct
+{
+	uint32_t FlashSize; /*!< Size of the flash */
+	uint32_t PageSize; /*!< Size of pages for the program operation */
+	uint32_t EraseSize[QSPI_ERASE_TYPES]; /*!< Size of each erase type, 0 if not available */
+	uint32_t EraseMaxTime[QSPI_ERASE_TYPES]; /*!< Maximum erase time of each erase type, ms */
+	uint32_t EraseTypTime[QSPI_ERASE_TYPES]; /*!< Typical erase time of each erase type, ms */
+	uint8_t EraseCmd[QSPI_ERASE_TYPES]; /*!< 4-byte address instruction of each erase type */
+	uint32_t ChipEraseMaxTime; /*!< Maximum chip erase time, ms */
+	uint8_t QuadOutCmd; /*!< 1-1-4 read 4-byte address instruction, 0 if not available */
+	uint8_t QuadOutDummyCycles; /*!< 1-1-4 read dummy cycles */
+	uint8_t QuadInOutCmd; /*!< 1-4-4 read 4-byte address instruction, 0 if not available */
+	uint8_t QuadInOutDummyCycles; /*!< 1-4-4 read dummy cycles after the mode clocks */
+	uint8_t QuadInOutModeClocks; /*!< 1-4-4 read mode clocks */
+	uint8_t Enter4ByteWren; /*!< Write enable needed before entering 4-byte address mode */
+} QSPI_FlashParams;
+
+/* QSPI driver statistics */
+typedef struct
+{
+	uint32_t PagesProgrammed; /*!< Pages sent to the memory by BSP_QSPI_Write() */
+	uint32_t PagesSkipped; /*!< All-0xFF pages BSP_QSPI_Write() did not send */
+	uint32_t PagesVerified; /*!< Pages read back after programming */
+	uint32_t BlocksErased; /*!< Blocks BSP_QSPI_Update() had to erase */
+} QSPI_Stats;
+
+/* QSPI interface timing */
+typedef struct
+{
+	uint32_t ClockPrescaler; /*!< QUADSPI clock = HCLK / (ClockPrescaler + 1) */
+	uint32_t SampleShifting; /*!< QSPI_SAMPLE_SHIFTING_NONE or QSPI_SAMPLE_SHIFTING_HALFCYCLE */
+} QSPI_Timing;
+
+/* QSPI calibration record, kept in a security register */
+typedef struct
+{
+	uint32_t Magic; /*!< QSPI_CALIB_MAGIC */
+	uint32_t ClockPrescaler; /*!< Calibrated QUADSPI clock prescaler */
+	uint32_t SampleShifting; /*!< Calibrated sample shifting */
+	uint8_t JedecId[3]; /*!< JEDEC ID of the memory the record belongs to */
+	uint8_t DummyCycles; /*!< Quad I/O read dummy cycles the record was taken with */
+	uint32_t Crc; /*!< CRC32 of the fields above */
+} QSPI_CalibRecord;
+
+/* QSPI read descriptor */
+typedef struct
+{
+	uint32_t Address; /*!< Flash address of the record */
+	uint32_t Size; /*!< Size of the record */
+	uint8_t *pData; /*!< Destination of the record */
+} QSPI_ReadDesc;
+
+/* QSPI read stream: sequential read of an area through a ring of chunk
+ * buffers refilled by DMA. The counters only grow, buffer n is
+ * pBuffer[n % NbBuffers]. */
+typedef struct
+{
+	uint8_t *pBuffer[QSPI_STREAM_MAX_BUFFERS]; /*!< Chunk buffers */
+	uint32_t Size[QSPI_STREAM_MAX_BUFFERS]; /*!< Valid bytes in each chunk buffer */
+	uint32_t NbBuffers; /*!< Number of chunk buffers, at least 2 */
+	uint32_t ChunkSize; /*!< Size of each chunk buffer */
+	uint32_t NextAddr; /*!< Next flash address to fetch */
+	uint32_t EndAddr; /*!< End of the streamed area */
+	uint32_t Started; /*!< Chunks whose fill was started */
+	volatile uint32_t Filled; /*!< Chunks filled */
+	uint32_t Consumed; /*!< Chunks handed to the consumer */
+	uint32_t Released; /*!< Chunks given back by the consumer */
+} QSPI_ReadStream;
+
 /**
  * @}
  */
@@ -123,11 +293,45 @@ typedef struct
  * @{
  */
 uint8_t BSP_QSPI_Init(void);
+uint8_t BSP_QSPI_Calibrate(void);
+uint8_t BSP_QSPI_GetTiming(QSPI_Timing *pTiming);
 uint8_t BSP_QSPI_Read(uint8_t *pData , uint32_t ReadAddr , uint32_t Size);
+uint8_t BSP_QSPI_ReadCacheLine(uint8_t *pData , uint32_t ReadAddr);
+uint8_t BSP_QSPI_ReadVector(QSPI_ReadDesc *pDesc , uint32_t Count);
+uint8_t BSP_QSPI_StreamOpen(QSPI_ReadStream *pStream , uint32_t ReadAddr , uint32_t Size ,
+							uint8_t **pBuffers , uint32_t NbBuffers , uint32_t ChunkSize);
+uint8_t BSP_QSPI_StreamNext(QSPI_ReadStream *pStream , uint8_t **pChunk , uint32_t *pSize);
+uint8_t BSP_QSPI_StreamClose(QSPI_ReadStream *pStream);
+uint8_t BSP_QSPI_Read_DMA(uint8_t *pData , uint32_t ReadAddr , uint32_t Size);
+uint8_t BSP_QSPI_WaitForTransfer(uint32_t Timeout);
+uint8_t BSP_QSPI_GetTransferStatus(void);
+void BSP_QSPI_ReadCpltCallback(void);
+uint8_t BSP_QSPI_SetReadMode(uint8_t ReadMode);
+uint8_t BSP_QSPI_GetReadMode(void);
+uint8_t BSP_QSPI_EnableDTR(uint8_t Enable);
 uint8_t BSP_QSPI_Write(uint8_t *pData , uint32_t WriteAddr , uint32_t Size);
+uint8_t BSP_QSPI_Write_DMA(uint8_t *pData , uint32_t WriteAddr , uint32_t Size);
+uint8_t BSP_QSPI_SetWelConfirm(uint8_t Enable);
+uint8_t BSP_QSPI_SetWriteVerify(uint8_t Enable);
+uint8_t BSP_QSPI_WriteBehind(uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+uint8_t BSP_QSPI_Flush(void);
+uint8_t BSP_QSPI_ClassifyOverwrite(const uint8_t *pOld, const uint8_t *pNew, uint32_t Size);
+uint8_t BSP_QSPI_Update(uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
 uint8_t BSP_QSPI_Erase_Sector(uint32_t EraseStartAddress, uint32_t EraseEndAddress);
+uint8_t BSP_QSPI_Erase_Block(uint32_t BlockAddress, uint32_t BlockSize);
+uint8_t BSP_QSPI_Erase_Block_IT(uint32_t BlockAddress, uint32_t BlockSize);
+uint8_t BSP_QSPI_Erase_Range(uint32_t EraseStartAddress, uint32_t EraseEndAddress);
 uint8_t BSP_QSPI_Erase_Chip(void);
 uint8_t BSP_QSPI_GetStatus(void);
 uint8_t BSP_QSPI_GetInfo(QSPI_Info *pInfo);
+uint8_t BSP_QSPI_GetFlashParams(QSPI_FlashParams *pParams);
+uint8_t BSP_QSPI_GetStats(QSPI_Stats *pStats);
+uint8_t BSP_QSPI_ResetStats(void);
+uint8_t BSP_QSPI_Manifest(uint32_t *pTable, uint32_t BlockSize, uint32_t NbBlocks);
 uint8_t BSP_QSPI_MemoryMappedMode(void);
+uint8_t BSP_QSPI_ExitMemoryMappedMode(void);
+uint8_t BSP_QSPI_SetMemoryMappedProfile(uint8_t Profile);
+uint8_t BSP_QSPI_SetMemoryMappedTimeout(uint16_t Period);
 uint8_t BSP_QSPI_Enter4ByteAddrMode(void);
+
+#endif /* W25Q256_H_ */
@@ -0,0 +1,312 @@
+/*
+ * W25q256_bench.c
+ *
+ */
+#include "W25q256_bench.h"
+
+/* QUADSPI memory-mapped window */
+#define BENCH_MMAP_BASE    0x90000000
+
+static uint32_t Bench_StartCycles;
+
+static uint32_t Bench_RandomLine(uint32_t *pSeed, uint32_t FlashSize);
+static void Bench_InvalidateWindow(uint32_t Address, uint32_t Size);
+static void Bench_InvalidateRandom(uint32_t Seed, uint32_t FlashSize, uint32_t Count);
+
+/**
+ * @brief  Enables the DWT cycle counter and takes the start timestamp.
+ * @retval None
+ */
+void BSP_QSPI_Bench_Start(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55; /* unlock the DWT on Cortex-M7 */
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	Bench_StartCycles = DWT->CYCCNT;
+}
+
+/**
+ * @brief  Returns the cycles elapsed since BSP_QSPI_Bench_Start().
+ * @retval CPU cycles
+ */
+uint32_t BSP_QSPI_Bench_Cycles(void)
+{
+	return DWT->CYCCNT - Bench_StartCycles;
+}
+
+/**
+ * @brief  Fills a result structure from a byte and cycle count.
+ * @param  pResult: result to fill
+ * @param  Bytes: number of bytes moved
+ * @param  Cycles: CPU cycles spent
+ * @retval None
+ */
+void BSP_QSPI_Bench_Result(QSPI_BenchResult *pResult, uint32_t Bytes, uint32_t Cycles)
+{
+	pResult->Bytes = Bytes;
+	pResult->Cycles = Cycles;
+	pResult->KBytesPerSecond = (Cycles == 0) ? 0 :
+			(uint32_t) (((uint64_t) Bytes * SystemCoreClock) / ((uint64_t) Cycles * 1024U));
+}
+
+/**
+ * @brief  Measures BSP_QSPI_Read() against BSP_QSPI_Read_DMA() on the same
+ *         flash area with the current read mode.
+ * @param  pPolled: result of the polled read
+ * @param  pDma: result of the DMA read
+ * @param  pBuffer: destination buffer of Size bytes
+ * @param  ReadAddr: Read start address
+ * @param  Size: Size of data to read
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Bench_Read(QSPI_BenchResult *pPolled, QSPI_BenchResult *pDma,
+							uint8_t *pBuffer, uint32_t ReadAddr, uint32_t Size)
+{
+	BSP_QSPI_Bench_Start();
+	if(BSP_QSPI_Read(pBuffer, ReadAddr, Size) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	BSP_QSPI_Bench_Result(pPolled, Size, BSP_QSPI_Bench_Cycles());
+
+	BSP_QSPI_Bench_Start();
+	if(BSP_QSPI_Read_DMA(pBuffer, ReadAddr, Size) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(BSP_QSPI_WaitForTransfer(HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	BSP_QSPI_Bench_Result(pDma, Size, BSP_QSPI_Bench_Cycles());
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Measures BSP_QSPI_Write() page programs with the WEL poll after
+ *         each WREN, then without it. The block is erased before each run,
+ *         outside of the measure. The difference of the two runs divided by
+ *         the number of pages is the overhead of the poll.
+ * @note   The block is left programmed with the pattern.
+ * @param  pConfirmed: result of the run with the WEL poll
+ * @param  pLean: result of the run without it
+ * @param  pBuffer: pattern buffer of Size bytes, filled here
+ * @param  WriteAddr: Write start address, aligned on MEMORY_SECTOR_SIZE
+ * @param  Size: Size of data to write, up to MEMORY_SECTOR_SIZE
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Bench_PageProgram(QSPI_BenchResult *pConfirmed, QSPI_BenchResult *pLean,
+								   uint8_t *pBuffer, uint32_t WriteAddr, uint32_t Size)
+{
+	QSPI_BenchResult *result;
+	uint32_t run, i;
+
+	if(((WriteAddr % MEMORY_SECTOR_SIZE) != 0) || (Size > MEMORY_SECTOR_SIZE))
+	{
+		return QSPI_ERROR;
+	}
+
+	/* No all-0xFF page, none is skipped */
+	for(i = 0 ; i < Size ; i++)
+	{
+		pBuffer[i] = (uint8_t) (i ^ (i >> 8));
+	}
+
+	for(run = 0 ; run < 2 ; run++)
+	{
+		result = (run == 0) ? pConfirmed : pLean;
+		BSP_QSPI_SetWelConfirm(run == 0);
+
+		if(BSP_QSPI_Erase_Block(WriteAddr, MEMORY_SECTOR_SIZE) != QSPI_OK)
+		{
+			BSP_QSPI_SetWelConfirm(0);
+			return QSPI_ERROR;
+		}
+
+		BSP_QSPI_Bench_Start();
+		if(BSP_QSPI_Write(pBuffer, WriteAddr, Size) != QSPI_OK)
+		{
+			BSP_QSPI_SetWelConfirm(0);
+			return QSPI_ERROR;
+		}
+		BSP_QSPI_Bench_Result(result, Size, BSP_QSPI_Bench_Cycles());
+	}
+
+	BSP_QSPI_SetWelConfirm(0);
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Measures random cache line reads, as done by table lookups and
+ *         by XIP code on cache misses: linear indirect reads of the line,
+ *         wrapped critical-byte-first reads, and 32-bit loads through the
+ *         memory-mapped window. The same pseudo-random lines are used by
+ *         the three runs, each read at a word inside the line.
+ * @param  pLinear: result of the BSP_QSPI_Read() runs
+ * @param  pWrap: result of the BSP_QSPI_ReadCacheLine() runs
+ * @param  pMapped: result of the memory-mapped loads
+ * @param  Count: number of lines read by each run
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Bench_CacheLine(QSPI_BenchResult *pLinear, QSPI_BenchResult *pWrap,
+								 QSPI_BenchResult *pMapped, uint32_t Count)
+{
+	uint8_t line[QSPI_CACHE_LINE_SIZE];
+	volatile uint32_t sink = 0;
+	QSPI_Info info;
+	uint32_t seed, address, i;
+
+	BSP_QSPI_GetInfo(&info);
+
+	seed = 1;
+	BSP_QSPI_Bench_Start();
+	for(i = 0 ; i < Count ; i++)
+	{
+		address = Bench_RandomLine(&seed, info.FlashSize);
+		if(BSP_QSPI_Read(line, address & ~(QSPI_CACHE_LINE_SIZE - 1), QSPI_CACHE_LINE_SIZE) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+	BSP_QSPI_Bench_Result(pLinear, Count * QSPI_CACHE_LINE_SIZE, BSP_QSPI_Bench_Cycles());
+
+	seed = 1;
+	BSP_QSPI_Bench_Start();
+	for(i = 0 ; i < Count ; i++)
+	{
+		address = Bench_RandomLine(&seed, info.FlashSize);
+		if(BSP_QSPI_ReadCacheLine(line, address) != QSPI_OK)
+		{
+			return QSPI_ERROR;
+		}
+	}
+	BSP_QSPI_Bench_Result(pWrap, Count * QSPI_CACHE_LINE_SIZE, BSP_QSPI_Bench_Cycles());
+
+	if(BSP_QSPI_MemoryMappedMode() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	seed = 1;
+	Bench_InvalidateRandom(seed, info.FlashSize, Count);
+	BSP_QSPI_Bench_Start();
+	for(i = 0 ; i < Count ; i++)
+	{
+		address = Bench_RandomLine(&seed, info.FlashSize);
+		sink += *(volatile uint32_t*) (BENCH_MMAP_BASE + address);
+	}
+	BSP_QSPI_Bench_Result(pMapped, Count * QSPI_CACHE_LINE_SIZE, BSP_QSPI_Bench_Cycles());
+	(void) sink;
+
+	return BSP_QSPI_ExitMemoryMappedMode();
+}
+
+/**
+ * @brief  Measures the memory-mapped mode with a given timeout: sequential
+ *         32-bit loads, random 32-bit loads, and the switch back to
+ *         indirect mode after the memory-mapped mode has been left idle.
+ *         The D-cache is bypassed by invalidating the lines read first and
+ *         reading each word once. Idle current is not measured here: keep the loop idle
+ *         in memory-mapped mode and read it on the supply.
+ * @param  pSequential: result of the sequential loads
+ * @param  pRandom: result of the random loads
+ * @param  pExit: cycles of BSP_QSPI_ExitMemoryMappedMode(), Bytes is 0
+ * @param  Timeout: QSPI_MMAP_TIMEOUT_xxx or a period in QUADSPI clocks
+ * @param  Size: bytes read by each load run
+ * @retval QSPI memory status
+ */
+uint8_t BSP_QSPI_Bench_MemoryMapped(QSPI_BenchResult *pSequential, QSPI_BenchResult *pRandom,
+									QSPI_BenchResult *pExit, uint16_t Timeout, uint32_t Size)
+{
+	volatile uint32_t sink = 0;
+	QSPI_Info info;
+	uint32_t seed = 1;
+	uint32_t i;
+
+	BSP_QSPI_GetInfo(&info);
+
+	if(BSP_QSPI_SetMemoryMappedTimeout(Timeout) != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	if(BSP_QSPI_MemoryMappedMode() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+
+	Bench_InvalidateWindow(0, Size);
+	BSP_QSPI_Bench_Start();
+	for(i = 0 ; i < Size ; i += 4)
+	{
+		sink += *(volatile uint32_t*) (BENCH_MMAP_BASE + i);
+	}
+	BSP_QSPI_Bench_Result(pSequential, Size, BSP_QSPI_Bench_Cycles());
+
+	Bench_InvalidateRandom(seed, info.FlashSize, Size / 4);
+	BSP_QSPI_Bench_Start();
+	for(i = 0 ; i < Size ; i += 4)
+	{
+		sink += *(volatile uint32_t*) (BENCH_MMAP_BASE + Bench_RandomLine(&seed, info.FlashSize));
+	}
+	BSP_QSPI_Bench_Result(pRandom, Size, BSP_QSPI_Bench_Cycles());
+	(void) sink;
+
+	/* Leave the prefetch idle long enough for the timeout to expire */
+	HAL_Delay(1);
+
+	BSP_QSPI_Bench_Start();
+	if(BSP_QSPI_ExitMemoryMappedMode() != QSPI_OK)
+	{
+		return QSPI_ERROR;
+	}
+	BSP_QSPI_Bench_Result(pExit, 0, BSP_QSPI_Bench_Cycles());
+
+	return QSPI_OK;
+}
+
+/**
+ * @brief  Returns a pseudo-random word address of the memory.
+ * @param  pSeed: generator state
+ * @param  FlashSize: size of the memory
+ * @retval Word aligned address
+ */
+static uint32_t Bench_RandomLine(uint32_t *pSeed, uint32_t FlashSize)
+{
+	*pSeed = (*pSeed * 1664525U) + 1013904223U;
+
+	return (*pSeed % FlashSize) & ~3U;
+}
+
+/**
+ * @brief  Invalidates the D-cache lines covering an area of the
+ *         memory-mapped window, so the loads go to the memory.
+ * @param  Address: memory address
+ * @param  Size: area size
+ * @retval None
+ */
+static void Bench_InvalidateWindow(uint32_t Address, uint32_t Size)
+{
+	uint32_t offset = Address & (QSPI_CACHE_LINE_SIZE - 1);
+
+	if((SCB->CCR & SCB_CCR_DC_Msk) != 0U)
+	{
+		SCB_InvalidateDCache_by_Addr((uint32_t*) (BENCH_MMAP_BASE + Address - offset), (int32_t) (Size + offset));
+	}
+}
+
+/**
+ * @brief  Invalidates the lines the random loads of a seed will touch.
+ * @param  Seed: generator state the loads start from
+ * @param  FlashSize: size of the memory
+ * @param  Count: number of loads
+ * @retval None
+ */
+static void Bench_InvalidateRandom(uint32_t Seed, uint32_t FlashSize, uint32_t Count)
+{
+	while(Count-- != 0)
+	{
+		Bench_InvalidateWindow(Bench_RandomLine(&Seed, FlashSize), 4);
+	}
+}
@@ -0,0 +1,32 @@
+/*
+ * W25q256_bench.h
+ *
+ * Cycle-accurate timing of the W25Q256 driver paths, based on the
+ * Cortex-M7 DWT cycle counter. Results are meant to be read with the
+ * debugger or printed by the application.
+ */
+#ifndef W25Q256_BENCH_H_
+#define W25Q256_BENCH_H_
+
+#include "w25q256.h"
+
+typedef struct
+{
+	uint32_t Bytes; /*!< Number of bytes moved */
+	uint32_t Cycles; /*!< CPU cycles spent, command setup included */
+	uint32_t KBytesPerSecond; /*!< Throughput at SystemCoreClock */
+} QSPI_BenchResult;
+
+void BSP_QSPI_Bench_Start(void);
+uint32_t BSP_QSPI_Bench_Cycles(void);
+void BSP_QSPI_Bench_Result(QSPI_BenchResult *pResult, uint32_t Bytes, uint32_t Cycles);
+uint8_t BSP_QSPI_Bench_Read(QSPI_BenchResult *pPolled, QSPI_BenchResult *pDma,
+							uint8_t *pBuffer, uint32_t ReadAddr, uint32_t Size);
+uint8_t BSP_QSPI_Bench_CacheLine(QSPI_BenchResult *pLinear, QSPI_BenchResult *pWrap,
+								 QSPI_BenchResult *pMapped, uint32_t Count);
+uint8_t BSP_QSPI_Bench_PageProgram(QSPI_BenchResult *pConfirmed, QSPI_BenchResult *pLean,
+								   uint8_t *pBuffer, uint32_t WriteAddr, uint32_t Size);
+uint8_t BSP_QSPI_Bench_MemoryMapped(QSPI_BenchResult *pSequential, QSPI_BenchResult *pRandom,
+									QSPI_BenchResult *pExit, uint16_t Timeout, uint32_t Size);
+
+#endif /* W25Q256_BENCH_H_ */
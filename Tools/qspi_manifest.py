@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Diffs a W25Q256 CRC manifest against a new image.
+
+The manifest is the QspiManifest table computed on the target by
+BSP_QSPI_Manifest() (build with QSPI_MANIFEST), dumped as raw little-endian
+32-bit words, for example with gdb:
+
+    dump binary memory manifest.bin &QspiManifest &QspiManifest[512]
+
+Each block covered by the image is compared by CRC32. The bytes of a block
+that the image does not cover are taken as erased, as the loader erases
+whole sectors. The tool prints the minimal list of erases and programs:
+
+    erase   0x90010000 0x00020000
+    program 0x90010000 0x00018000
+
+Blocks already blank are programmed without erase, blocks whose new content
+is blank are erased without program.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+
+def parse_int(text):
+    return int(text, 0)
+
+
+def coalesce(blocks, block_size, base):
+    """Merges consecutive block indexes into (address, size) ranges."""
+    ranges = []
+    for block in blocks:
+        address = base + block * block_size
+        if ranges and ranges[-1][0] + ranges[-1][1] == address:
+            ranges[-1][1] += block_size
+        else:
+            ranges.append([address, block_size])
+    return ranges
+
+
+def plan(manifest, image, address, block_size, base):
+    """Returns the blocks to erase and the blocks to program."""
+    offset = address - base
+    first = offset // block_size
+    last = (offset + len(image) + block_size - 1) // block_size
+    if last > len(manifest):
+        raise ValueError("image ends beyond the manifest")
+
+    blank = b"\xff" * block_size
+    blank_crc = zlib.crc32(blank)
+    erase = []
+    program = []
+    for block in range(first, last):
+        start = block * block_size - offset
+        data = bytearray(blank)
+        lo = max(start, 0)
+        hi = min(start + block_size, len(image))
+        data[lo - start:hi - start] = image[lo:hi]
+
+        if zlib.crc32(data) == manifest[block]:
+            continue
+        if manifest[block] != blank_crc:
+            erase.append(block)
+        if data != blank:
+            program.append(block)
+    return erase, program
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("manifest", help="raw manifest dumped from the target")
+    parser.add_argument("image", help="new binary image")
+    parser.add_argument("--address", type=parse_int, default=0x90000000,
+                        help="load address of the image (default 0x90000000)")
+    parser.add_argument("--block-size", type=parse_int, default=0x10000,
+                        help="block size of the manifest (default 0x10000)")
+    parser.add_argument("--base", type=parse_int, default=0x90000000,
+                        help="address of block 0 (default 0x90000000)")
+    args = parser.parse_args()
+
+    with open(args.manifest, "rb") as f:
+        raw = f.read()
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if len(raw) % 4 != 0:
+        sys.exit("manifest size is not a multiple of 4")
+    manifest = struct.unpack("<%dI" % (len(raw) // 4), raw)
+    if args.address < args.base:
+        sys.exit("image address below the manifest base")
+
+    try:
+        erase, program = plan(manifest, image, args.address, args.block_size, args.base)
+    except ValueError as error:
+        sys.exit(str(error))
+
+    for address, size in coalesce(erase, args.block_size, args.base):
+        print("erase   0x%08X 0x%08X" % (address, size))
+    for address, size in coalesce(program, args.block_size, args.base):
+        print("program 0x%08X 0x%08X" % (address, size))
+    sys.stderr.write("%d blocks to erase, %d blocks to program\n" % (len(erase), len(program)))
+
+
+if __name__ == "__main__":
+    main()
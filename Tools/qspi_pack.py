@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Packs an image for the LZ4 packed writes of the external loader.
+
+The loader must be built with LOADER_PACKED_WRITE=1. The image is cut in
+frames of at most 64K that do not cross a 64K boundary. Each frame is an
+LZ4 block behind a 16-byte header (magic "QPLZ", address, unpacked size,
+packed size), and the stream ends with an all-0xFF header. The output is
+programmed at the packed window that follows the memory:
+
+    qspi_pack.py app.bin app.qplz --address 0x90000000
+    STM32_Programmer_CLI ... -w app.qplz 0x92000000
+
+The blocks are compressed with the lz4 module when it is installed, with a
+simple greedy compressor otherwise.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x5A4C5051
+END = 0xFFFFFFFF
+FLASH_BASE = 0x90000000
+FLASH_SIZE = 0x02000000
+FRAME_SIZE = 0x10000
+
+MIN_MATCH = 4
+LAST_LITERALS = 5
+MATCH_LIMIT = 12
+MAX_OFFSET = 0xFFFF
+
+
+def parse_int(text):
+    return int(text, 0)
+
+
+def put_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def put_sequence(out, literals, offset=0, match=0):
+    literal_length = len(literals)
+    token = min(literal_length, 15) << 4
+    if offset:
+        token |= min(match - MIN_MATCH, 15)
+    out.append(token)
+    if literal_length >= 15:
+        put_length(out, literal_length - 15)
+    out += literals
+    if offset:
+        out += struct.pack("<H", offset)
+        if match - MIN_MATCH >= 15:
+            put_length(out, match - MIN_MATCH - 15)
+
+
+def lz4_compress_greedy(data):
+    """Greedy LZ4 block compressor, one candidate per 4-byte key."""
+    size = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+    while pos < size - MATCH_LIMIT:
+        key = data[pos:pos + MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+        if candidate is None or pos - candidate > MAX_OFFSET:
+            pos += 1
+            continue
+
+        # Extend the match by slices, then byte by byte
+        match = MIN_MATCH
+        limit = size - LAST_LITERALS - pos
+        while match < limit:
+            step = min(256, limit - match)
+            if data[pos + match:pos + match + step] == data[candidate + match:candidate + match + step]:
+                match += step
+                continue
+            while match < limit and data[pos + match] == data[candidate + match]:
+                match += 1
+            break
+
+        put_sequence(out, data[anchor:pos], pos - candidate, match)
+        pos += match
+        anchor = pos
+    put_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def lz4_compress(data):
+    try:
+        import lz4.block
+    except ImportError:
+        return lz4_compress_greedy(data)
+    return lz4.block.compress(data, mode="high_compression", store_size=False)
+
+
+def pack(image, address):
+    """Returns the packed stream of an image loaded at address."""
+    stream = bytearray()
+    offset = 0
+    while offset < len(image):
+        frame_address = address + offset
+        size = min(FRAME_SIZE - (frame_address % FRAME_SIZE), len(image) - offset)
+        block = lz4_compress(image[offset:offset + size])
+        stream += struct.pack("<4I", MAGIC, frame_address, size, len(block))
+        stream += block
+        offset += size
+    stream += struct.pack("<4I", END, END, END, END)
+    return bytes(stream)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="binary image")
+    parser.add_argument("output", help="packed stream")
+    parser.add_argument("--address", type=parse_int, default=FLASH_BASE,
+                        help="load address of the image (default 0x90000000)")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if args.address < FLASH_BASE or args.address + len(image) > FLASH_BASE + FLASH_SIZE:
+        sys.exit("image does not fit in the memory")
+
+    stream = pack(image, args.address)
+    with open(args.output, "wb") as f:
+        f.write(stream)
+    sys.stderr.write("%d bytes packed in %d bytes, program at 0x%08X\n"
+                     % (len(image), len(stream), FLASH_BASE + FLASH_SIZE))
+
+
+if __name__ == "__main__":
+    main()